@@ -0,0 +1,38 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+
+// Heap allocation counters, fed by the replacement operator new in
+// alloc_hook.cpp. A target that does not compile alloc_hook.cpp still builds,
+// the counters just stay at zero.
+struct AllocationCounters {
+    std::atomic<unsigned long long> count; // operator new calls, every thread
+    std::atomic<unsigned long long> bytes; // Bytes requested, every thread
+};
+
+// Process-wide counters (constant-initialized, safe to use from operator new)
+inline AllocationCounters& allocations() {
+    static AllocationCounters counters = { { 0 }, { 0 } };
+    return counters;
+}
+
+// Allocations made by the calling thread, so the tick loop can be checked
+// while the checkpoint, trajectory and telemetry threads allocate freely
+inline unsigned long long& threadAllocations() {
+    static thread_local unsigned long long count = 0;
+    return count;
+}
+
+// Counts the calling thread's allocations from construction to count()
+class AllocationScope {
+private:
+    unsigned long long start;
+
+public:
+    AllocationScope() : start(threadAllocations()) {}
+
+    unsigned long long count() const {
+        return threadAllocations() - start;
+    }
+};
\ No newline at end of file
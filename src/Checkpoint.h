@@ -0,0 +1,440 @@
+#pragma once
+
+#include <Windows.h>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Simulation.h"
+
+// Checkpoint file: an append-only log of records. The first record holds every
+// section; later records hold only the sections whose contents changed. Restore
+// takes the newest intact copy of each section, so a torn final record is
+// ignored. Values are stored little-endian with their in-memory bit patterns.
+//
+//   file    = "BEECKPT\0" u32 version u32 reserved, record*
+//   record  = u32 'RCRD' u32 sectionCount u64 tick, section*, u32 'DONE' u32 sectionCount
+//   section = u32 id u32 reserved u64 size u64 fnv1a(payload), payload
+namespace checkpoint {
+
+const uint32_t version = 6;
+const uint32_t recordMagic = 0x44524352;  // "RCRD"
+const uint32_t recordEnd = 0x454E4F44;    // "DONE"
+const int maxRecords = 64;                 // Rewrite the file in full after this many records
+
+enum SectionId : uint32_t {
+    terrainSection = 1, // Terrain exponent and height grid
+    colonySection = 2,  // Clock, timers, pollen, colony RNG and config
+    beesSection = 3,    // Every bee's MemberState
+    flowersSection = 4, // Flower positions and nectar
+    sectionCount = 5
+};
+
+inline uint64_t fnv1a(const std::string& bytes) {
+    uint64_t hash = 1469598103934665603ull;
+    for (unsigned char c : bytes) {
+        hash ^= c;
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+// Appends fields to a byte string
+class Writer {
+public:
+    std::string bytes;
+
+    template <typename T>
+    void put(const T& value) {
+        bytes.append(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    void putVec3(const glm::vec3& v) {
+        put(v.x);
+        put(v.y);
+        put(v.z);
+    }
+};
+
+// Reads fields back; `ok` turns false on a short read and stays false
+class Reader {
+private:
+    const char* data;
+    size_t size;
+    size_t offset;
+
+public:
+    bool ok;
+
+    Reader(const char* data, size_t size) : data(data), size(size), offset(0), ok(true) {}
+
+    template <typename T>
+    T get() {
+        T value = T();
+        if (!ok || size - offset < sizeof(T)) {
+            ok = false;
+            return value;
+        }
+        memcpy(&value, data + offset, sizeof(T));
+        offset += sizeof(T);
+        return value;
+    }
+
+    glm::vec3 getVec3() {
+        float x = get<float>();
+        float y = get<float>();
+        float z = get<float>();
+        return glm::vec3(x, y, z);
+    }
+
+    bool done() const {
+        return ok && offset == size;
+    }
+};
+
+inline std::string encodeTerrain(const TerrainState& terrain) {
+    Writer w;
+    w.put((int32_t)terrain.n);
+    w.put((int32_t)terrain.heights.size());
+    for (const auto& row : terrain.heights) {
+        w.bytes.append(reinterpret_cast<const char*>(row.data()), row.size() * sizeof(float));
+    }
+    return w.bytes;
+}
+
+inline std::string encodeColony(const SimulationState& state) {
+    Writer w;
+    w.put(state.tick);
+    w.put(state.clock);
+    w.put(state.beeTimer);
+    w.put(state.flowerTimer);
+    w.put((int32_t)state.plnCount);
+    w.put(state.rng);
+    w.put((int32_t)state.config.initialBees);
+    w.put((int32_t)state.config.maxBees);
+    w.put((int32_t)state.config.flowerCount);
+    w.put((int32_t)state.config.maxPollen);
+    w.put(state.config.beeSpawnSeconds);
+    w.put(state.config.flowerSeconds);
+    w.put(state.config.seed);
+    w.put(state.config.cohesionTheta);
+    w.put((int32_t)state.config.lodSlices);
+    w.put(state.config.lodViewRadius);
+    w.put((int32_t)state.config.lodMaxSteers);
+    w.put(state.config.nectarLoads);
+    w.put(state.config.nectarRefillSeconds);
+    return w.bytes;
+}
+
+inline std::string encodeBees(const std::vector<MemberState>& bees) {
+    Writer w;
+    w.put((uint32_t)bees.size());
+    for (const auto& b : bees) {
+        w.putVec3(b.p);
+        w.putVec3(b.v);
+        w.putVec3(b.a);
+        w.putVec3(b.d);
+        w.putVec3(b.h);
+        w.putVec3(b.color);
+        w.put((uint8_t)(b.returnHome ? 1 : 0));
+        w.put((int32_t)b.pollen);
+        w.put(b.rng);
+        w.put(b.clearance);
+    }
+    return w.bytes;
+}
+
+inline std::string encodeFlowers(const std::vector<glm::vec3>& flowers, const std::vector<float>& nectar) {
+    Writer w;
+    w.put((uint32_t)flowers.size());
+    for (size_t f = 0; f < flowers.size(); f++) {
+        w.putVec3(flowers[f]);
+        w.put(nectar[f]);
+    }
+    return w.bytes;
+}
+
+inline bool decodeTerrain(const std::string& bytes, TerrainState& terrain) {
+    Reader r(bytes.data(), bytes.size());
+    terrain.n = r.get<int32_t>();
+    int side = r.get<int32_t>();
+    if (!r.ok || terrain.n < 1 || terrain.n > 16 || side != (1 << terrain.n) + 1) {
+        return false;
+    }
+    terrain.heights.assign(side, std::vector<float>(side));
+    for (auto& row : terrain.heights) {
+        for (auto& h : row) {
+            h = r.get<float>();
+        }
+    }
+    return r.done();
+}
+
+inline bool decodeColony(const std::string& bytes, SimulationState& state) {
+    Reader r(bytes.data(), bytes.size());
+    state.tick = r.get<uint64_t>();
+    state.clock = r.get<double>();
+    state.beeTimer = r.get<double>();
+    state.flowerTimer = r.get<double>();
+    state.plnCount = r.get<int32_t>();
+    state.rng = r.get<uint64_t>();
+    state.config.initialBees = r.get<int32_t>();
+    state.config.maxBees = r.get<int32_t>();
+    state.config.flowerCount = r.get<int32_t>();
+    state.config.maxPollen = r.get<int32_t>();
+    state.config.beeSpawnSeconds = r.get<double>();
+    state.config.flowerSeconds = r.get<double>();
+    state.config.seed = r.get<uint64_t>();
+    state.config.cohesionTheta = r.get<float>();
+    state.config.lodSlices = r.get<int32_t>();
+    state.config.lodViewRadius = r.get<float>();
+    state.config.lodMaxSteers = r.get<int32_t>();
+    state.config.nectarLoads = r.get<float>();
+    state.config.nectarRefillSeconds = r.get<float>();
+    return r.done();
+}
+
+inline bool decodeBees(const std::string& bytes, std::vector<MemberState>& bees) {
+    Reader r(bytes.data(), bytes.size());
+    uint32_t count = r.get<uint32_t>();
+    if (!r.ok || count > bytes.size()) {
+        return false;
+    }
+    bees.resize(count);
+    for (auto& b : bees) {
+        b.p = r.getVec3();
+        b.v = r.getVec3();
+        b.a = r.getVec3();
+        b.d = r.getVec3();
+        b.h = r.getVec3();
+        b.color = r.getVec3();
+        b.returnHome = r.get<uint8_t>() != 0;
+        b.pollen = r.get<int32_t>();
+        b.rng = r.get<uint64_t>();
+        b.clearance = r.get<float>();
+    }
+    return r.done();
+}
+
+inline bool decodeFlowers(const std::string& bytes, std::vector<glm::vec3>& flowers, std::vector<float>& nectar) {
+    Reader r(bytes.data(), bytes.size());
+    uint32_t count = r.get<uint32_t>();
+    if (!r.ok || count > bytes.size()) {
+        return false;
+    }
+    flowers.resize(count);
+    nectar.resize(count);
+    for (size_t f = 0; f < count; f++) {
+        flowers[f] = r.getVec3();
+        nectar[f] = r.get<float>();
+    }
+    return r.done();
+}
+
+// Read a checkpoint file into `state`. False if the file is missing, has the
+// wrong version or lacks any section.
+inline bool load(const std::string& path, SimulationState& state) {
+    FILE* fid = fopen(path.c_str(), "rb");
+    if (fid == NULL) {
+        std::cerr << "can't open checkpoint " << path << std::endl;
+        return false;
+    }
+    std::string file;
+    char buffer[65536];
+    size_t n;
+    while ((n = fread(buffer, 1, sizeof(buffer), fid)) > 0) {
+        file.append(buffer, n);
+    }
+    fclose(fid);
+
+    Reader r(file.data(), file.size());
+    char magic[8];
+    for (auto& c : magic) c = r.get<char>();
+    uint32_t fileVersion = r.get<uint32_t>();
+    r.get<uint32_t>();
+    if (!r.ok || memcmp(magic, "BEECKPT", 8) != 0 || fileVersion != version) {
+        std::cerr << "not a version " << version << " checkpoint: " << path << std::endl;
+        return false;
+    }
+
+    // Walk the records, keeping the newest copy of each section from intact records
+    std::string latest[sectionCount];
+    size_t offset = 16;
+    while (offset < file.size()) {
+        Reader record(file.data() + offset, file.size() - offset);
+        if (record.get<uint32_t>() != recordMagic) break;
+        uint32_t sections = record.get<uint32_t>();
+        record.get<uint64_t>(); // Tick, informational
+        size_t cursor = offset + 16;
+        std::string found[sectionCount];
+        bool intact = record.ok;
+        for (uint32_t i = 0; i < sections && intact; i++) {
+            Reader header(file.data() + cursor, file.size() - cursor);
+            uint32_t id = header.get<uint32_t>();
+            header.get<uint32_t>();
+            uint64_t size = header.get<uint64_t>();
+            uint64_t hash = header.get<uint64_t>();
+            cursor += 24;
+            if (!header.ok || id == 0 || id >= sectionCount || size > file.size() - cursor) {
+                intact = false;
+                break;
+            }
+            found[id] = file.substr(cursor, (size_t)size);
+            cursor += (size_t)size;
+            intact = fnv1a(found[id]) == hash;
+        }
+        Reader footer(file.data() + (intact ? cursor : offset), intact ? file.size() - cursor : 0);
+        if (!intact || footer.get<uint32_t>() != recordEnd || footer.get<uint32_t>() != sections) {
+            break; // Torn or corrupt record, everything before it is still valid
+        }
+        for (int id = 1; id < sectionCount; id++) {
+            if (!found[id].empty()) latest[id].swap(found[id]);
+        }
+        offset = cursor + 8;
+    }
+
+    std::shared_ptr<TerrainState> terrain = std::make_shared<TerrainState>();
+    if (!decodeTerrain(latest[terrainSection], *terrain)
+        || !decodeColony(latest[colonySection], state)
+        || !decodeBees(latest[beesSection], state.bees)
+        || !decodeFlowers(latest[flowersSection], state.flowers, state.nectar)) {
+        std::cerr << "incomplete checkpoint: " << path << std::endl;
+        return false;
+    }
+    state.terrain = terrain;
+    return true;
+}
+
+}
+
+// Writes checkpoints on a background thread. submit() only moves a captured
+// SimulationState into a one-slot mailbox, so the tick never waits on disk; if
+// the writer is still busy the older pending state is replaced by the newer.
+class Checkpointer {
+private:
+    std::string path;                         // Checkpoint file
+    std::thread worker;                       // Writer thread
+    std::mutex mutex;                         // Guards pending and stopping
+    std::condition_variable wake;             // Signalled on submit and stop
+    std::unique_ptr<SimulationState> pending; // Newest state not yet written
+    bool stopping;                            // Set by the destructor
+
+    // Writer-thread state
+    uint64_t writtenHash[checkpoint::sectionCount]; // Hash of the last written copy of each section
+    const TerrainState* writtenTerrain;             // Terrain already in the file
+    int records;                                    // Records in the current file
+
+    // Append one record with the changed sections, or rewrite the file in full
+    void write(const SimulationState& state) {
+        using namespace checkpoint;
+        bool full = records == 0 || records >= maxRecords;
+
+        std::string payload[sectionCount];
+        if (full || state.terrain.get() != writtenTerrain) {
+            payload[terrainSection] = encodeTerrain(*state.terrain);
+        }
+        payload[colonySection] = encodeColony(state);
+        payload[beesSection] = encodeBees(state.bees);
+        payload[flowersSection] = encodeFlowers(state.flowers, state.nectar);
+
+        Writer record;
+        uint32_t sections = 0;
+        std::string body;
+        for (int id = 1; id < sectionCount; id++) {
+            if (payload[id].empty() && id == terrainSection) continue;
+            uint64_t hash = fnv1a(payload[id]);
+            if (!full && hash == writtenHash[id]) continue; // Unchanged since the last record
+            Writer section;
+            section.put((uint32_t)id);
+            section.put((uint32_t)0);
+            section.put((uint64_t)payload[id].size());
+            section.put(hash);
+            body += section.bytes;
+            body += payload[id];
+            writtenHash[id] = hash;
+            sections++;
+        }
+        record.put(recordMagic);
+        record.put(sections);
+        record.put(state.tick);
+        record.bytes += body;
+        record.put(recordEnd);
+        record.put(sections);
+
+        std::string target = full ? path + ".tmp" : path;
+        FILE* fid = fopen(target.c_str(), full ? "wb" : "ab");
+        if (fid == NULL) {
+            std::cerr << "can't write checkpoint " << target << std::endl;
+            records = 0;
+            return;
+        }
+        if (full) {
+            Writer header;
+            header.bytes.append("BEECKPT", 8);
+            header.put(version);
+            header.put((uint32_t)0);
+            fwrite(header.bytes.data(), 1, header.bytes.size(), fid);
+        }
+        fwrite(record.bytes.data(), 1, record.bytes.size(), fid);
+        fflush(fid);
+        fclose(fid);
+
+        if (full) {
+            // Swap the new file in only once it is complete
+            if (!MoveFileExA(target.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING)) {
+                std::cerr << "can't replace checkpoint " << path << std::endl;
+                records = 0;
+                return;
+            }
+            records = 0;
+        }
+        writtenTerrain = state.terrain.get();
+        records++;
+    }
+
+    void run() {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true) {
+            wake.wait(lock, [this]() { return pending || stopping; });
+            if (!pending) {
+                break; // Stopping with nothing left to write
+            }
+            std::unique_ptr<SimulationState> state(std::move(pending));
+            lock.unlock();
+            write(*state);
+            lock.lock();
+        }
+    }
+
+public:
+    explicit Checkpointer(const std::string& path)
+        : path(path), stopping(false), writtenTerrain(nullptr), records(0) {
+        for (auto& h : writtenHash) h = 0;
+        worker = std::thread(&Checkpointer::run, this);
+    }
+
+    // Write whatever is still pending, then stop the writer
+    ~Checkpointer() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        worker.join();
+    }
+
+    // Queue a captured state for writing
+    void submit(SimulationState&& state) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            pending.reset(new SimulationState(std::move(state)));
+        }
+        wake.notify_one();
+    }
+};
\ No newline at end of file
@@ -0,0 +1,192 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+#include <glm/glm.hpp>
+#include "LandMass.h"
+#include "MemoryBudget.h"
+
+// Signed distance to the terrain on a 3D grid over the flight volume:
+// positive above the ground, negative below. Built from the height grid with
+// a separable Euclidean distance transform (Felzenszwalb-Huttenlocher) and
+// sampled trilinearly, so a lookup is one 8-corner read giving the distance
+// and its gradient, which points away from the ground. Accurate to about a
+// cell. The terrain never changes after generation, so the field is built
+// once; build() again if it ever does.
+class ClearanceField {
+public:
+    // Distance to the ground at a point and the direction it grows fastest
+    struct Sample {
+        float distance;    // Signed distance to the terrain surface
+        glm::vec3 gradient; // Per-unit change of the distance along each axis
+    };
+
+private:
+    glm::vec3 origin;           // Minimum corner of the grid
+    float cell;                 // Cell side
+    int columns;                // Cells along x
+    int rows;                   // Cells along z
+    int layers;                 // Cells along y
+    std::vector<float> field;   // Signed distance at each cell center, [(x * rows + z) * layers + y]
+    MemoryCharge memory;        // Field bytes, charged to the terrain account
+
+    size_t index(int i, int j, int l) const {
+        return ((size_t)i * rows + j) * layers + l;
+    }
+
+    // Squared distance transform of one line of `count` samples `stride`
+    // apart, in place: each sample becomes the least of (q - r)^2 + f(r).
+    // `from`, `parabolas` and `bounds` are scratch of at least count + 1.
+    static void transformLine(float* f, size_t stride, int count, float* from, int* parabolas, float* bounds) {
+        for (int q = 0; q < count; q++) from[q] = f[q * stride];
+
+        // Lower envelope of the parabolas rooted at each sample: parabolas[k]
+        // is lowest between bounds[k] and bounds[k + 1]
+        auto meet = [from](int q, int r) {
+            return ((from[q] + (float)q * q) - (from[r] + (float)r * r)) / (2.0f * (q - r));
+        };
+        int k = 0;
+        parabolas[0] = 0;
+        bounds[0] = -INFINITY;
+        bounds[1] = INFINITY;
+        for (int q = 1; q < count; q++) {
+            float s = meet(q, parabolas[k]);
+            while (s <= bounds[k]) {
+                k--;
+                s = meet(q, parabolas[k]);
+            }
+            k++;
+            parabolas[k] = q;
+            bounds[k] = s;
+            bounds[k + 1] = INFINITY;
+        }
+        k = 0;
+        for (int q = 0; q < count; q++) {
+            while (bounds[k + 1] < q) k++;
+            int r = parabolas[k];
+            f[q * stride] = (float)(q - r) * (q - r) + from[r];
+        }
+    }
+
+    // Squared distance, in cells, from every cell to the nearest cell marked 0
+    // in `f` (others must hold a large value)
+    void transform(std::vector<float>& f) const {
+        int longest = std::max(columns, std::max(rows, layers));
+        std::vector<float> from(longest + 1);
+        std::vector<int> parabolas(longest + 1);
+        std::vector<float> bounds(longest + 2);
+        for (int i = 0; i < columns; i++) {
+            for (int j = 0; j < rows; j++) {
+                transformLine(&f[index(i, j, 0)], 1, layers, from.data(), parabolas.data(), bounds.data());
+            }
+        }
+        for (int i = 0; i < columns; i++) {
+            for (int l = 0; l < layers; l++) {
+                transformLine(&f[index(i, 0, l)], layers, rows, from.data(), parabolas.data(), bounds.data());
+            }
+        }
+        for (int j = 0; j < rows; j++) {
+            for (int l = 0; l < layers; l++) {
+                transformLine(&f[index(0, j, l)], (size_t)rows * layers, columns, from.data(), parabolas.data(), bounds.data());
+            }
+        }
+    }
+
+public:
+    // Grid of `cellSize` cells over `bounds`, stretched down to the lowest
+    // terrain point and one cell past the top
+    ClearanceField(const LandMass& land, const BoundBox& bounds, float cellSize)
+        : cell(cellSize), memory(memoryTerrain) {
+        float lowest = bounds.min.y;
+        for (const auto& line : land.getHeightGrid()) {
+            for (float h : line) lowest = std::min(lowest, h);
+        }
+        origin = glm::vec3(bounds.min.x, lowest - cell, bounds.min.z);
+        columns = std::max((int)std::ceil((bounds.max.x - bounds.min.x) / cell), 2);
+        rows = std::max((int)std::ceil((bounds.max.z - bounds.min.z) / cell), 2);
+        layers = std::max((int)std::ceil((bounds.max.y + cell - origin.y) / cell), 2);
+        build(land);
+    }
+
+    // Recompute the field from the terrain's heights
+    void build(const LandMass& land) {
+        size_t count = (size_t)columns * rows * layers;
+        std::vector<glm::vec2> centers((size_t)columns * rows);
+        std::vector<float> ground(centers.size());
+        for (int i = 0; i < columns; i++) {
+            for (int j = 0; j < rows; j++) {
+                centers[(size_t)i * rows + j] = glm::vec2(origin.x + (i + 0.5f) * cell, origin.z + (j + 0.5f) * cell);
+            }
+        }
+        land.getHeights(centers, ground.data());
+
+        // Cells whose center is at or under the ground are solid. Transform to
+        // the nearest solid cell for the open ones and to the nearest open cell
+        // for the solid ones; the surface lies half a cell between the two.
+        const float unreached = 1e20f; // Stands in for infinity, which would make the envelope NaN
+        std::vector<float> toSolid(count);
+        std::vector<float> toOpen(count);
+        for (int i = 0; i < columns; i++) {
+            for (int j = 0; j < rows; j++) {
+                float h = ground[(size_t)i * rows + j];
+                for (int l = 0; l < layers; l++) {
+                    bool solid = origin.y + (l + 0.5f) * cell <= h;
+                    toSolid[index(i, j, l)] = solid ? 0.0f : unreached;
+                    toOpen[index(i, j, l)] = solid ? unreached : 0.0f;
+                }
+            }
+        }
+        transform(toSolid);
+        transform(toOpen);
+
+        field.resize(count);
+        for (size_t c = 0; c < count; c++) {
+            field[c] = toSolid[c] > 0.0f
+                ? (std::sqrt(toSolid[c]) - 0.5f) * cell
+                : -(std::sqrt(toOpen[c]) - 0.5f) * cell;
+        }
+        memory.set(capacityBytes(field), 0);
+    }
+
+    // Distance and gradient at `p`, clamped to the grid
+    Sample sample(const glm::vec3& p) const {
+        glm::vec3 u = (p - origin) / cell - glm::vec3(0.5f);
+        u = glm::clamp(u, glm::vec3(0.0f), glm::vec3((float)(columns - 1), (float)(layers - 1), (float)(rows - 1)));
+        int i = std::min((int)u.x, columns - 2);
+        int l = std::min((int)u.y, layers - 2);
+        int j = std::min((int)u.z, rows - 2);
+        glm::vec3 t = u - glm::vec3((float)i, (float)l, (float)j);
+
+        // Corners as c[x][z][y]
+        const float* c00 = &field[index(i, j, l)];
+        const float* c01 = &field[index(i, j + 1, l)];
+        const float* c10 = &field[index(i + 1, j, l)];
+        const float* c11 = &field[index(i + 1, j + 1, l)];
+        float y00 = c00[0] + (c00[1] - c00[0]) * t.y;
+        float y01 = c01[0] + (c01[1] - c01[0]) * t.y;
+        float y10 = c10[0] + (c10[1] - c10[0]) * t.y;
+        float y11 = c11[0] + (c11[1] - c11[0]) * t.y;
+        float z0 = y00 + (y01 - y00) * t.z;
+        float z1 = y10 + (y11 - y10) * t.z;
+
+        Sample s;
+        s.distance = z0 + (z1 - z0) * t.x;
+        s.gradient.x = (z1 - z0) / cell;
+        s.gradient.z = ((y01 - y00) + ((y11 - y10) - (y01 - y00)) * t.x) / cell;
+        float dy0 = (c00[1] - c00[0]) + ((c01[1] - c01[0]) - (c00[1] - c00[0])) * t.z;
+        float dy1 = (c10[1] - c10[0]) + ((c11[1] - c11[0]) - (c10[1] - c10[0])) * t.z;
+        s.gradient.y = (dy0 + (dy1 - dy0) * t.x) / cell;
+        return s;
+    }
+
+    float distance(const glm::vec3& p) const {
+        return sample(p).distance;
+    }
+
+    // Most a sampled distance can change per unit moved: the interpolation
+    // changes by at most one unit per unit along each axis
+    static float steepest() {
+        return 1.7320508f; // sqrt(3)
+    }
+};
\ No newline at end of file
@@ -0,0 +1,230 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <queue>
+#include <utility>
+#include <vector>
+#include <glm/glm.hpp>
+#include "LandMass.h"
+#include "MemoryBudget.h"
+
+// Navigation fields on a 2.5D grid over the terrain's x/z extent, so steering
+// a bee is one cell lookup instead of a scan over every flower:
+//  - Flower field: each cell holds the flower nearest its center among those
+//    within `range` of it, and that distance. Adding or removing a flower only
+//    touches the cells within `range` of it. The chosen flower is the minimum
+//    over a fixed order (distance, then position), so incremental updates and
+//    a full rebuild give the same field. Cells also keep the flower's index,
+//    so a bee that reaches it needs no search: flowers are numbered as they
+//    bloom and wither oldest first, as Simulation keeps them, so an index is
+//    the flower's number less the count withered so far.
+//  - Homing field: each cell holds the x/z heading of the cheapest way to the
+//    hive over the terrain, where climbing costs extra. Built once by Dijkstra
+//    from the hive cell, since neither the terrain nor the hive moves.
+class FlowField {
+public:
+    // What a cell knows about the flowers around a point
+    struct NearestFlower {
+        bool found;          // A flower lies within range of the cell
+        glm::vec3 position;  // That flower, when found
+        int index;           // Its index among the living flowers, oldest first; -1 when none
+        float lowerBound;    // No flower is closer than this to the point
+    };
+
+private:
+    glm::vec2 origin;                // x/z of the grid's minimum corner
+    float cell;                      // Cell side
+    int columns;                     // Cells along x
+    int rows;                        // Cells along z
+    float range;                     // Flowers further from a cell center are left out of it
+    std::vector<glm::vec3> nearest;  // Nearest flower to each cell center, by cell
+    std::vector<uint32_t> number;    // Its bloom number, by cell
+    std::vector<float> distance;     // Its x/z distance from the center, `range` when there is none
+    uint32_t bloomed;                // Flowers numbered so far; the next bloom number
+    uint32_t withered;               // Flowers removed so far; the bloom number of the oldest living one
+    std::vector<glm::vec2> homing;   // Unit x/z heading home from each cell, 0 in the hive's cell
+    MemoryCharge flowerMemory;       // Flower field bytes, charged to the flower account
+    MemoryCharge homingMemory;       // Homing field bytes, charged to the terrain account
+
+    int column(float x) const {
+        return std::min(std::max((int)std::floor((x - origin.x) / cell), 0), columns - 1);
+    }
+
+    int row(float z) const {
+        return std::min(std::max((int)std::floor((z - origin.y) / cell), 0), rows - 1);
+    }
+
+    glm::vec2 center(int i, int j) const {
+        return origin + glm::vec2((i + 0.5f) * cell, (j + 0.5f) * cell);
+    }
+
+    static float across(const glm::vec2& from, const glm::vec3& to) {
+        return glm::length(glm::vec2(to.x, to.z) - from);
+    }
+
+    // The fixed order flowers are chosen by: nearer first, then by position
+    static bool before(float d, const glm::vec3& f, float bestD, const glm::vec3& best) {
+        if (d != bestD) return d < bestD;
+        if (f.x != best.x) return f.x < best.x;
+        if (f.z != best.z) return f.z < best.z;
+        return f.y < best.y;
+    }
+
+    // Offer flower `f`, bloom number `n`, to every cell within range of it
+    void offer(const glm::vec3& f, uint32_t n) {
+        for (int i = column(f.x - range); i <= column(f.x + range); i++) {
+            for (int j = row(f.z - range); j <= row(f.z + range); j++) {
+                size_t c = (size_t)i * rows + j;
+                float d = across(center(i, j), f);
+                if (d < range && before(d, f, distance[c], nearest[c])) {
+                    nearest[c] = f;
+                    number[c] = n;
+                    distance[c] = d;
+                }
+            }
+        }
+    }
+
+public:
+    FlowField(const BoundBox& bounds, float cellSize, float range)
+        : origin(bounds.min.x, bounds.min.z), cell(cellSize), range(range), bloomed(0), withered(0),
+        flowerMemory(memoryFlowers), homingMemory(memoryTerrain) {
+        columns = std::max((int)std::ceil((bounds.max.x - bounds.min.x) / cell), 1);
+        rows = std::max((int)std::ceil((bounds.max.z - bounds.min.z) / cell), 1);
+        nearest.assign((size_t)columns * rows, glm::vec3(0.0f));
+        number.assign(nearest.size(), 0);
+        distance.assign(nearest.size(), range);
+        homing.assign(nearest.size(), glm::vec2(0.0f));
+        flowerMemory.set(capacityBytes(nearest) + capacityBytes(number) + capacityBytes(distance), 0);
+        homingMemory.set(capacityBytes(homing), 0);
+    }
+
+    // Build the homing field toward `hive`. Each step costs its x/z length
+    // plus `climbCost` per unit the terrain rises along it. A cell heads for
+    // the cell a few steps further along its way home, which smooths the 16
+    // step directions the search moves in.
+    void setHome(const glm::vec3& hive, const LandMass& land, float climbCost) {
+        static const int steps[16][2] = {
+            { 1, 0 }, { -1, 0 }, { 0, 1 }, { 0, -1 }, { 1, 1 }, { 1, -1 }, { -1, 1 }, { -1, -1 },
+            { 1, 2 }, { 2, 1 }, { -1, 2 }, { -2, 1 }, { 1, -2 }, { 2, -1 }, { -1, -2 }, { -2, -1 }
+        };
+        const int lookahead = 4; // Steps along the way home a heading aims at
+
+        size_t count = homing.size();
+        std::vector<glm::vec2> centers(count);
+        std::vector<float> ground(count);
+        for (int i = 0; i < columns; i++) {
+            for (int j = 0; j < rows; j++) {
+                centers[(size_t)i * rows + j] = center(i, j);
+            }
+        }
+        land.getHeights(centers, ground.data());
+
+        std::vector<float> cost(count, INFINITY);
+        std::vector<uint32_t> next(count); // Following cell on the way home
+        uint32_t home = (uint32_t)((size_t)column(hive.x) * rows + row(hive.z));
+        typedef std::pair<float, uint32_t> Entry;
+        std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> open;
+        cost[home] = 0.0f;
+        next[home] = home;
+        open.push(Entry(0.0f, home));
+        while (!open.empty()) {
+            Entry e = open.top();
+            open.pop();
+            uint32_t b = e.second;
+            if (e.first > cost[b]) continue;
+            int bi = (int)(b / rows);
+            int bj = (int)(b % rows);
+            for (const auto& s : steps) {
+                int i = bi + s[0];
+                int j = bj + s[1];
+                if (i < 0 || i >= columns || j < 0 || j >= rows) continue;
+                uint32_t a = (uint32_t)((size_t)i * rows + j);
+                float c = cost[b] + cell * std::sqrt((float)(s[0] * s[0] + s[1] * s[1]))
+                    + climbCost * std::max(ground[b] - ground[a], 0.0f);
+                if (c < cost[a]) {
+                    cost[a] = c;
+                    next[a] = b;
+                    open.push(Entry(c, a));
+                }
+            }
+        }
+
+        for (uint32_t a = 0; a < count; a++) {
+            uint32_t target = a;
+            for (int k = 0; k < lookahead; k++) target = next[target];
+            glm::vec2 offset = center(target / rows, target % rows) - center(a / rows, a % rows);
+            homing[a] = target != a ? glm::normalize(offset) : glm::vec2(0.0f);
+        }
+    }
+
+    // Replace the flower field by one for `fps`, oldest first
+    void setFlowers(const std::vector<glm::vec3>& fps) {
+        std::fill(distance.begin(), distance.end(), range);
+        bloomed = 0;
+        withered = 0;
+        for (const auto& f : fps) addFlower(f);
+    }
+
+    // A flower opens after the others
+    void addFlower(const glm::vec3& f) {
+        uint32_t n = bloomed++;
+        if (!glm::any(glm::isnan(f))) offer(f, n);
+    }
+
+    // Take flower `f`, the oldest, out of the field. `remaining` is the
+    // flower set without it, oldest first; the cells `f` was nearest to are
+    // chosen again from those.
+    void removeFlower(const glm::vec3& f, const std::vector<glm::vec3>& remaining) {
+        uint32_t oldest = withered++;
+        if (glm::any(glm::isnan(f))) return;
+        for (int i = column(f.x - range); i <= column(f.x + range); i++) {
+            for (int j = row(f.z - range); j <= row(f.z + range); j++) {
+                size_t c = (size_t)i * rows + j;
+                if (distance[c] >= range || number[c] != oldest) continue;
+                glm::vec2 mid = center(i, j);
+                distance[c] = range;
+                for (size_t k = 0; k < remaining.size(); k++) {
+                    const glm::vec3& g = remaining[k];
+                    if (glm::any(glm::isnan(g))) continue;
+                    float d = across(mid, g);
+                    if (d < range && before(d, g, distance[c], nearest[c])) {
+                        nearest[c] = g;
+                        number[c] = withered + (uint32_t)k;
+                        distance[c] = d;
+                    }
+                }
+            }
+        }
+    }
+
+    // Flower for a bee at `p` to make for, from the cell it is in
+    NearestFlower nearestFlower(const glm::vec3& p) const {
+        int i = column(p.x);
+        int j = row(p.z);
+        size_t c = (size_t)i * rows + j;
+        float offCenter = across(center(i, j), p);
+        NearestFlower n;
+        n.found = distance[c] < range;
+        n.position = nearest[c];
+        n.index = n.found ? (int)(number[c] - withered) : -1;
+        n.lowerBound = std::max(distance[c] - offCenter, 0.0f); // x/z distance bounds the 3D one
+        return n;
+    }
+
+    // Unit direction for a bee at `p` to fly home to `hive`: the homing
+    // field's heading across, the straight line's slope up or down. Straight
+    // at the hive within a couple of cells of it, where the field is coarse.
+    glm::vec3 homeHeading(const glm::vec3& p, const glm::vec3& hive) const {
+        glm::vec3 toHive = hive - p;
+        glm::vec2 heading = homing[(size_t)column(p.x) * rows + row(p.z)];
+        float flat = glm::length(glm::vec2(toHive.x, toHive.z));
+        if (flat < 2.0f * cell || heading == glm::vec2(0.0f)) {
+            return glm::normalize(toHive);
+        }
+        return glm::normalize(glm::vec3(heading.x * flat, toHive.y, heading.y * flat));
+    }
+};
\ No newline at end of file
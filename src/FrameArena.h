@@ -0,0 +1,122 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+#include <vector>
+#include "MemoryBudget.h"
+
+// Non-owning view of a contiguous array: arena memory or a std::vector
+template <typename T>
+struct Span {
+    const T* data;
+    size_t size;
+
+    Span() : data(nullptr), size(0) {}
+    Span(const T* data, size_t size) : data(data), size(size) {}
+    Span(const std::vector<T>& v) : data(v.data()), size(v.size()) {}
+
+    const T* begin() const { return data; }
+    const T* end() const { return data + size; }
+    const T& operator[](size_t i) const { return data[i]; }
+    bool empty() const { return size == 0; }
+};
+
+// Bump allocator for tick-scoped scratch buffers. alloc() hands out pieces of
+// a few large blocks and reset() rewinds to the first block in O(1), so once
+// the blocks have grown to the busiest tick nothing touches the heap again.
+// Only for trivially destructible types: nothing is ever destroyed.
+class FrameArena {
+private:
+    struct Block {
+        std::unique_ptr<char[]> memory;
+        size_t size;
+    };
+
+    size_t blockSize;          // Default size of a new block
+    std::vector<Block> blocks; // Every block ever allocated, reused after reset()
+    size_t current;            // Block being carved up
+    size_t offset;             // Bytes used in the current block
+    size_t used;               // Bytes handed out since the last reset
+    size_t highWater;          // Largest `used` seen at a reset
+    MemoryCharge memory;       // Block bytes, charged to the scratch account
+
+    void chargeBlocks() {
+        long long bytes = 0;
+        for (const auto& b : blocks) bytes += (long long)b.size;
+        memory.set(bytes, 0);
+    }
+
+    // Move to the next block that can hold `bytes`, growing the list if needed
+    void nextBlock(size_t bytes, size_t align) {
+        while (++current < blocks.size()) {
+            if (blocks[current].size >= bytes + align) {
+                offset = 0;
+                return;
+            }
+        }
+        Block b;
+        b.size = bytes + align > blockSize ? bytes + align : blockSize;
+        b.memory.reset(new char[b.size]);
+        blocks.push_back(std::move(b));
+        current = blocks.size() - 1;
+        offset = 0;
+        chargeBlocks();
+    }
+
+public:
+    explicit FrameArena(size_t blockSize = 64 * 1024)
+        : blockSize(blockSize), current(0), offset(0), used(0), highWater(0), memory(memoryScratch) {}
+
+    FrameArena(const FrameArena&) = delete;
+    FrameArena& operator=(const FrameArena&) = delete;
+
+    // Raw memory, valid until the next reset()
+    void* allocate(size_t bytes, size_t align) {
+        if (blocks.empty()) {
+            current = (size_t)-1;
+            nextBlock(bytes, align);
+        }
+        uintptr_t base = (uintptr_t)blocks[current].memory.get();
+        size_t start = (size_t)(((base + offset + align - 1) & ~(uintptr_t)(align - 1)) - base);
+        if (start + bytes > blocks[current].size) {
+            nextBlock(bytes, align);
+            base = (uintptr_t)blocks[current].memory.get();
+            start = (size_t)(((base + align - 1) & ~(uintptr_t)(align - 1)) - base);
+        }
+        offset = start + bytes;
+        used += bytes;
+        return blocks[current].memory.get() + start;
+    }
+
+    // Uninitialized array of `count` T
+    template <typename T>
+    T* alloc(size_t count) {
+        static_assert(std::is_trivially_destructible<T>::value, "FrameArena never runs destructors");
+        return static_cast<T*>(allocate(count * sizeof(T), alignof(T)));
+    }
+
+    // Release everything handed out since the last reset. When a tick needed more
+    // than one block, the blocks are merged so the next tick fits in the first.
+    void reset() {
+        if (used > highWater) highWater = used;
+        if (current > 0 && blocks[0].size < highWater * 2) {
+            size_t total = highWater * 2 > blockSize ? highWater * 2 : blockSize;
+            blocks.clear();
+            Block b;
+            b.size = total;
+            b.memory.reset(new char[total]);
+            blocks.push_back(std::move(b));
+            chargeBlocks();
+        }
+        current = 0;
+        offset = 0;
+        used = 0;
+    }
+
+    // Most memory any tick has used
+    size_t peakBytes() const {
+        return highWater > used ? highWater : used;
+    }
+};
\ No newline at end of file
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "Object.h"
+#include "FrameArena.h"
 #include <ctime>
 #include <random>
 #include <vector>
@@ -8,8 +9,19 @@
 #include <fstream>
 #include <sstream>
 #include <string>
+#if defined(__AVX2__)
+#include <immintrin.h> // Gathers for getHeights
+#endif
 
 class LandMass {
+public:
+    // Where a straight move first meets the ground
+    struct GroundHit {
+        float t;          // Fraction of the move made before the contact
+        glm::vec3 point;  // Contact point, on the surface
+        glm::vec3 normal; // Unit surface normal there, pointing up
+    };
+
 private:
     int width;               // Width of the grid
     int height;              // Height of the grid
@@ -22,16 +34,145 @@ private:
     GLuint planeBuffer;      // Buffer for plane indices
 
     glm::mat4 modelMatrix;   // Model transformation matrix
+    QuantizeParams quantize; // Dequantization scale/offset for the packed positions
+
+    std::vector<PackedVertex> packedVertices; // Generated vertices awaiting upload()
+    std::vector<GLuint> planeIndices;         // Generated indices awaiting upload()
 
     std::vector<std::vector<float>> heightGrid; // 2D grid of height values
+    std::vector<float> flatHeights;             // The same grid in one array, [x * gridSize + z], for height queries
+    std::vector<glm::vec2> cellRange;           // Lowest and highest corner of each grid cell, [x * (gridSize - 1) + z]
+    std::vector<float> maxMip;                  // Highest corner in each square of 2^L by 2^L cells, level L from mipStart[L]
+    std::vector<size_t> mipStart;               // Offset of each level of maxMip, finest (single cells) first
     std::mt19937 generator;                     // Random number generator
     std::uniform_real_distribution<float> floatDistribution; // Distribution for random numbers
 
+    MemoryCharge memory = MemoryCharge(memoryTerrain); // Grid, generated mesh and GPU buffers
+
+    // Heap bytes of the height grid
+    long long gridBytes() const {
+        long long bytes = capacityBytes(heightGrid) + capacityBytes(flatHeights) + capacityBytes(cellRange)
+            + capacityBytes(maxMip) + capacityBytes(mipStart);
+        for (const auto& row : heightGrid) bytes += capacityBytes(row);
+        return bytes;
+    }
+
+    // Bilinear height at grid coordinates (fx, fz), which must lie in [0, gridSize - 1]
+    float interpolate(float fx, float fz) const {
+        int i = std::min((int)fx, gridSize - 2);
+        int j = std::min((int)fz, gridSize - 2);
+        float tx = fx - i;
+        float tz = fz - j;
+        const float* h = flatHeights.data() + (size_t)i * gridSize + j;
+        float atX0 = h[0] + (h[1] - h[0]) * tz;
+        float atX1 = h[gridSize] + (h[gridSize + 1] - h[gridSize]) * tz;
+        return atX0 + (atX1 - atX0) * tx;
+    }
+
+    // First time in [ta, tb] the move from `from` along (d.x, dy, d.y) in grid
+    // coordinates `a` + d * t is at or under the surface of cell (i, j), or
+    // -1. Over one cell the bilinear height along the move is quadratic in t,
+    // so the crossing is solved for exactly.
+    float crossCell(int i, int j, const glm::vec2& a, const glm::vec2& d, float y0, float dy, float ta, float tb) const {
+        glm::vec2 range = cellRange[(size_t)i * (gridSize - 1) + j];
+        float ya = y0 + dy * ta;
+        float yb = y0 + dy * tb;
+        if (std::min(ya, yb) > range.y) return -1.0f; // Over the cell's highest corner
+        if (std::max(ya, yb) < range.x) return ta;    // Under its lowest: in the ground from the start
+
+        // Height above the surface, f(t) = A t^2 + B t + C, with the cell's
+        // bilinear height h00 + cx u + cz w + cxz u w at u = px + d.x t, w = pz + d.y t
+        const float* h = flatHeights.data() + (size_t)i * gridSize + j;
+        float cx = h[gridSize] - h[0];
+        float cz = h[1] - h[0];
+        float cxz = h[gridSize + 1] - h[gridSize] - h[1] + h[0];
+        float px = a.x - i;
+        float pz = a.y - j;
+        float A = -cxz * d.x * d.y;
+        float B = dy - (cx * d.x + cz * d.y + cxz * (px * d.y + pz * d.x));
+        float C = y0 - (h[0] + cx * px + cz * pz + cxz * px * pz);
+        if ((A * ta + B) * ta + C <= 0.0f) return ta;
+
+        float root = INFINITY;
+        if (std::fabs(A) < 1e-12f) {
+            if (B < 0.0f) root = -C / B;
+        }
+        else {
+            float disc = B * B - 4.0f * A * C;
+            if (disc >= 0.0f) {
+                float q = -0.5f * (B + std::copysign(std::sqrt(disc), B));
+                float r1 = q / A;
+                float r2 = q != 0.0f ? C / q : INFINITY;
+                if (r1 >= ta && r1 <= tb) root = r1;
+                if (r2 >= ta && r2 <= tb) root = std::min(root, r2);
+            }
+        }
+        if (root >= ta && root <= tb) return root;
+        return (A * tb + B) * tb + C <= 0.0f ? tb : -1.0f; // A grazing crossing rounding lost
+    }
+
+    // Part [t0, t1] of the move a + d * t in grid coordinates that lies over
+    // the grid, t0 and t1 coming in as the range to clip; false if none does
+    bool clipToGrid(const glm::vec2& a, const glm::vec2& d, float& t0, float& t1) const {
+        float last = gridSize - 1.0f;
+        for (int k = 0; k < 2; k++) {
+            if (d[k] == 0.0f) {
+                if (!(a[k] >= 0.0f && a[k] <= last)) return false;
+            }
+            else {
+                float enter = -a[k] / d[k];
+                float exit = (last - a[k]) / d[k];
+                t0 = std::max(t0, std::min(enter, exit));
+                t1 = std::min(t1, std::max(enter, exit));
+            }
+        }
+        return t0 <= t1;
+    }
+
+    // Max-height pyramid over the cells: level 0 is each cell's highest
+    // corner, every level above holds the highest of the four squares under it
+    void buildMaxMip() {
+        int cells = gridSize - 1;
+        mipStart.clear();
+        size_t total = 0;
+        for (int side = cells; side >= 1; side /= 2) {
+            mipStart.push_back(total);
+            total += (size_t)side * side;
+        }
+        maxMip.resize(total);
+        for (size_t c = 0; c < cellRange.size(); c++) maxMip[c] = cellRange[c].y;
+        for (size_t level = 1; level < mipStart.size(); level++) {
+            int side = cells >> level;
+            const float* below = maxMip.data() + mipStart[level - 1];
+            float* above = maxMip.data() + mipStart[level];
+            for (int i = 0; i < side; i++) {
+                for (int j = 0; j < side; j++) {
+                    const float* q = below + (size_t)(2 * i) * (2 * side) + 2 * j;
+                    above[(size_t)i * side + j] = std::max(std::max(q[0], q[1]), std::max(q[2 * side], q[2 * side + 1]));
+                }
+            }
+        }
+    }
+
+    // sweep() for the part [ta, tb] of a move that is off the grid, where the
+    // ground is the plane y = 0
+    static bool sweepFlat(const glm::vec3& from, const glm::vec3& to, float ta, float tb, GroundHit& hit) {
+        float dy = to.y - from.y;
+        float t = from.y + dy * ta <= 0.0f ? ta : (from.y + dy * tb <= 0.0f ? -from.y / dy : -1.0f);
+        if (!(t >= ta)) return false;
+        hit.t = t;
+        hit.point = from + (to - from) * t;
+        hit.point.y = 0.0f;
+        hit.normal = glm::vec3(0.0f, 1.0f, 0.0f);
+        return true;
+    }
+
     // Helper function to scale a value from one range to another
     float scaleValue(float value, float originalMin, float originalMax, float targetMin, float targetMax) {
         return targetMin + ((value - originalMin) / (originalMax - originalMin)) * (targetMax - targetMin);
     }
 
+public:
     // Function to generate terrain using the diamond-square algorithm
     std::vector<std::vector<float>> fractleGen(int size) {
         // Initialize a 2D grid of heights with zero
@@ -42,11 +183,19 @@ private:
         std::mt19937 generator(static_cast<unsigned int>(std::time(0))); // Seed random generator
         std::uniform_real_distribution<float> floatDistribution(-scale, scale); // Random value distribution
 
-        // Try loading a height map from a file
+        // Try loading a height map from a file, or from the executable in
+        // embedded builds
+#ifdef EMBED_MESHES
+        const embedded::EmbeddedFile* baked = embedded::findFile("Height_Map.txt");
+        std::istringstream inputFile(baked != nullptr ? baked->text : "");
+        bool mapFound = baked != nullptr;
+#else
         std::ifstream inputFile("src/Height_Map.txt");
+        bool mapFound = inputFile.is_open();
+#endif
         std::string line;
 
-        if (inputFile.is_open()) {
+        if (mapFound) {
             std::cout << "File found, Loading..." << std::endl;
             std::vector<std::vector<float>> map;
             while (getline(inputFile, line)) {
@@ -66,8 +215,6 @@ private:
                     heightGrid[i * 3][j * 3] = map[i][j];
                 }
             }
-
-            inputFile.close();
         }
         else {
             std::cout << "File not found, Randomizing..." << std::endl;
@@ -133,10 +280,17 @@ private:
         return heightGrid;
     }
 
-public:
-    // Constructor for LandMass class
-    LandMass(int n, GLuint shaderProgram)
-        : program(shaderProgram),
+    // Generate the terrain without any GL calls, so it can run on a worker thread.
+    // upload() must be called on the main thread before the terrain is displayed.
+    explicit LandMass(int n)
+        : LandMass(n, std::vector<std::vector<float>>()) {}
+
+    // Build the terrain from a saved height grid (checkpoint restore). An empty
+    // grid generates a new one. No GL calls, like LandMass(int).
+    LandMass(int n, const std::vector<std::vector<float>>& heights)
+        : program(0),
+        planeVAO(0),
+        planeBuffer(0),
         gridSize(pow(2, n) + 1),
         displace(pow(1.25, n)),
         modelMatrix(1.0f),
@@ -146,24 +300,28 @@ public:
         width = 512;  // Set width of the viewport
         height = 512; // Set height of the viewport
 
-        GLuint vbuffer; // Vertex buffer object
-        GLint vPosition; // Position attribute location
-        GLint vNormal;   // Normal attribute location
-
-        int vs; // Vertex shader
-        int fs; // Fragment shader
-
         // Initialize vertex and normal data
         std::vector<GLfloat> vertices(gridSize * gridSize * 4);
         std::vector<GLfloat> normals(gridSize * gridSize * 3);
-        std::vector<GLuint> indices((gridSize - 1) * (gridSize - 1) * 6);
+        std::vector<GLuint>& indices = planeIndices;
+        indices.resize((gridSize - 1) * (gridSize - 1) * 6);
         triangleCount = (gridSize - 1) * (gridSize - 1) * 6; // Calculate total triangles
 
-        vs = buildShader(GL_VERTEX_SHADER, "src/assign1.vs"); // Compile vertex shader
-        fs = buildShader(GL_FRAGMENT_SHADER, "src/assign1.fs"); // Compile fragment shader
-        program = buildProgram(vs, fs, 0); // Link shader program
-
-        heightGrid = fractleGen(gridSize); // Generate height grid
+        heightGrid = heights.empty() ? fractleGen(gridSize) : heights; // Generate height grid
+        flatHeights.resize((size_t)gridSize * gridSize);
+        for (int i = 0; i < gridSize; i++) {
+            std::copy(heightGrid[i].begin(), heightGrid[i].end(), flatHeights.begin() + (size_t)i * gridSize);
+        }
+        cellRange.resize((size_t)(gridSize - 1) * (gridSize - 1));
+        for (int i = 0; i + 1 < gridSize; i++) {
+            for (int j = 0; j + 1 < gridSize; j++) {
+                const float* h = flatHeights.data() + (size_t)i * gridSize + j;
+                cellRange[(size_t)i * (gridSize - 1) + j] = glm::vec2(
+                    std::min(std::min(h[0], h[1]), std::min(h[gridSize], h[gridSize + 1])),
+                    std::max(std::max(h[0], h[1]), std::max(h[gridSize], h[gridSize + 1])));
+            }
+        }
+        buildMaxMip();
 
         // Populate vertex and normal data
         for (int i = 0; i < gridSize; i++) {
@@ -202,35 +360,69 @@ public:
             }
         }
 
+        // Pack positions and normals into the compressed interleaved layout
+        int vertexCount = gridSize * gridSize;
+        quantize = computeQuantizeParams(vertices.data(), vertexCount, 4);
+        packedVertices.resize(vertexCount);
+        for (int v = 0; v < vertexCount; v++) {
+            glm::vec3 position(vertices[v * 4], vertices[v * 4 + 1], vertices[v * 4 + 2]);
+            glm::vec3 normal(normals[v * 3], normals[v * 3 + 1], normals[v * 3 + 2]);
+            packedVertices[v] = packVertex(position, normal, quantize);
+        }
+        memory.set(gridBytes() + capacityBytes(packedVertices) + capacityBytes(planeIndices), 0);
+    }
+
+    // Memory a terrain of exponent n holds once uploaded: the height grid, cell
+    // ranges and max pyramid on the CPU and the vertex and index buffers on
+    // the GPU. Used to pick a terrain size that fits the memory budget.
+    static long long estimateBytes(int n) {
+        long long side = (1LL << n) + 1;
+        long long grid = side * (long long)sizeof(std::vector<float>) + 2 * side * side * (long long)sizeof(float)
+            + (side - 1) * (side - 1) * (long long)sizeof(glm::vec2);
+        for (long long cells = side - 1; cells >= 1; cells /= 2) {
+            grid += cells * cells * (long long)sizeof(float) + (long long)sizeof(size_t);
+        }
+        long long buffers = side * side * (long long)sizeof(PackedVertex) + (side - 1) * (side - 1) * 6 * (long long)sizeof(GLuint);
+        return grid + buffers;
+    }
+
+    // Build the shader program and GPU buffers for the generated terrain (main thread only)
+    void upload() {
+        GLuint vbuffer; // Vertex buffer object
+
+        program = getProgram("src/assign1.vs", "src/assign1.fs"); // Cached terrain shader program
+
         // Create and bind VAO and VBO for the plane
         glGenVertexArrays(1, &planeVAO);
         glBindVertexArray(planeVAO);
 
         glGenBuffers(1, &vbuffer);
         glBindBuffer(GL_ARRAY_BUFFER, vbuffer);
-        glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(GLfloat) + normals.size() * sizeof(GLfloat), NULL, GL_STATIC_DRAW);
-
-        glBufferSubData(GL_ARRAY_BUFFER, 0, vertices.size() * sizeof(GLfloat), vertices.data());
-        glBufferSubData(GL_ARRAY_BUFFER, vertices.size() * sizeof(GLfloat), normals.size() * sizeof(GLfloat), normals.data());
+        glBufferData(GL_ARRAY_BUFFER, packedVertices.size() * sizeof(PackedVertex), packedVertices.data(), GL_STATIC_DRAW);
 
         glGenBuffers(1, &planeBuffer);
         glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, planeBuffer);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLuint), indices.data(), GL_STATIC_DRAW);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, planeIndices.size() * sizeof(GLuint), planeIndices.data(), GL_STATIC_DRAW);
+        memory.set(memory.cpu(), (long long)(packedVertices.size() * sizeof(PackedVertex) + planeIndices.size() * sizeof(GLuint)));
 
         // Bind vertex attributes
         glUseProgram(program);
+        bindPackedAttributes(program);
 
-        vPosition = glGetAttribLocation(program, "vPosition");
-        glVertexAttribPointer(vPosition, 4, GL_FLOAT, GL_FALSE, 0, (void*)0);
-        glEnableVertexAttribArray(vPosition);
+        // The GPU owns the mesh now, release the CPU copies
+        discardMeshData();
+    }
 
-        vNormal = glGetAttribLocation(program, "vNormal");
-        glVertexAttribPointer(vNormal, 3, GL_FLOAT, GL_FALSE, 0, (void*)(vertices.size() * sizeof(GLfloat)));
-        glEnableVertexAttribArray(vNormal);
+    // Release the generated vertex/index arrays (after upload, or when running headless)
+    void discardMeshData() {
+        std::vector<PackedVertex>().swap(packedVertices);
+        std::vector<GLuint>().swap(planeIndices);
+        memory.set(gridBytes(), memory.gpu());
     }
 
     // Display function to render the LandMass
     void display(const glm::mat4 viewMat, const glm::mat4 projectionMat, const glm::vec3 eyePosition) {
+        PROFILE_ZONE("LandMass::display");
         glUseProgram(program);
 
         GLint modelLoc = glGetUniformLocation(program, "modelView");
@@ -245,11 +437,14 @@ public:
         GLint displaceLoc = glGetUniformLocation(program, "displace");
         glUniform1f(displaceLoc, displace);
 
+        setQuantizeUniforms(program, quantize);
+
         glViewport(0, 0, width, height);
 
         glBindVertexArray(planeVAO);
         glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, planeBuffer);
         glDrawElements(GL_TRIANGLES, triangleCount, GL_UNSIGNED_INT, NULL);
+        telemetryAdd(telemetry().drawCalls, 1);
     }
 
     // Getter for grid size
@@ -257,6 +452,18 @@ public:
         return gridSize;
     }
 
+    // Exponent n the terrain was built with (grid side 2^n + 1)
+    int getExponent() const {
+        int n = 0;
+        while ((1 << n) + 1 < gridSize) n++;
+        return n;
+    }
+
+    // Height values, indexed [x][z]
+    const std::vector<std::vector<float>>& getHeightGrid() const {
+        return heightGrid;
+    }
+
     // Calculate bounding box for the LandMass
     BoundBox getBounds(float minHeight = 0.0f) {
         float halfGridSize = gridSize / 2.0f; // Half of the grid size
@@ -274,20 +481,231 @@ public:
         return boundary;
     }
 
-    // Get height at a specific (x, z) location
-    float getHeight(float x, float z) {
+    // Get height at a specific (x, z) location, interpolated bilinearly
+    // between the four surrounding grid points
+    float getHeight(float x, float z) const {
         float halfGridSize = gridSize / 2.0f; // Center the grid
 
-        // Convert world coordinates to grid indices
-        int gridX = static_cast<int>(x + halfGridSize);
-        int gridZ = static_cast<int>(z + halfGridSize);
+        // Convert world coordinates to grid coordinates
+        float fx = x + halfGridSize;
+        float fz = z + halfGridSize;
 
         // Ensure coordinates are within bounds
-        if (gridX < 0 || gridX >= gridSize || gridZ < 0 || gridZ >= gridSize) {
+        if (!(fx >= 0.0f && fx < gridSize && fz >= 0.0f && fz < gridSize)) {
             return 0.0f; // Return 0.0 for out-of-bounds queries
         }
+        return interpolate(std::min(fx, gridSize - 1.0f), std::min(fz, gridSize - 1.0f));
+    }
 
-        // Return height from the grid
-        return heightGrid[gridX][gridZ];
+    // getHeight for a batch of (x, z) points, written to heights[0 .. points.size).
+    // Builds with AVX2 do eight points at a time with gathers, bit-identical to
+    // getHeight; the rest goes through the scalar path.
+    void getHeights(Span<glm::vec2> points, float* heights) const {
+        size_t k = 0;
+#if defined(__AVX2__)
+        const float half = gridSize / 2.0f;
+        const __m256 halfGrid = _mm256_set1_ps(half);
+        const __m256 zero = _mm256_setzero_ps();
+        const __m256 size = _mm256_set1_ps((float)gridSize);
+        const __m256 last = _mm256_set1_ps(gridSize - 1.0f);
+        const __m256i lastCell = _mm256_set1_epi32(gridSize - 2);
+        const __m256i stride = _mm256_set1_epi32(gridSize);
+        const __m256i one = _mm256_set1_epi32(1);
+        const float* grid = flatHeights.data();
+        for (; k + 8 <= points.size; k += 8) {
+            // Split x0 z0 x1 z1 ... into x0..x7 and z0..z7
+            const float* xz = &points.data[k].x;
+            __m256 a = _mm256_loadu_ps(xz);
+            __m256 b = _mm256_loadu_ps(xz + 8);
+            __m256 xs = _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(_mm256_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0))), _MM_SHUFFLE(3, 1, 2, 0)));
+            __m256 zs = _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(_mm256_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1))), _MM_SHUFFLE(3, 1, 2, 0)));
+
+            __m256 fx = _mm256_add_ps(xs, halfGrid);
+            __m256 fz = _mm256_add_ps(zs, halfGrid);
+            __m256 inside = _mm256_and_ps(
+                _mm256_and_ps(_mm256_cmp_ps(fx, zero, _CMP_GE_OQ), _mm256_cmp_ps(fx, size, _CMP_LT_OQ)),
+                _mm256_and_ps(_mm256_cmp_ps(fz, zero, _CMP_GE_OQ), _mm256_cmp_ps(fz, size, _CMP_LT_OQ)));
+            fx = _mm256_and_ps(_mm256_min_ps(fx, last), inside); // Outside points read cell 0 and are masked out
+            fz = _mm256_and_ps(_mm256_min_ps(fz, last), inside);
+
+            __m256i i = _mm256_min_epi32(_mm256_cvttps_epi32(fx), lastCell);
+            __m256i j = _mm256_min_epi32(_mm256_cvttps_epi32(fz), lastCell);
+            __m256 tx = _mm256_sub_ps(fx, _mm256_cvtepi32_ps(i));
+            __m256 tz = _mm256_sub_ps(fz, _mm256_cvtepi32_ps(j));
+            __m256i index = _mm256_add_epi32(_mm256_mullo_epi32(i, stride), j);
+            __m256 h00 = _mm256_i32gather_ps(grid, index, 4);
+            __m256 h01 = _mm256_i32gather_ps(grid, _mm256_add_epi32(index, one), 4);
+            __m256i next = _mm256_add_epi32(index, stride);
+            __m256 h10 = _mm256_i32gather_ps(grid, next, 4);
+            __m256 h11 = _mm256_i32gather_ps(grid, _mm256_add_epi32(next, one), 4);
+
+            __m256 atX0 = _mm256_add_ps(h00, _mm256_mul_ps(_mm256_sub_ps(h01, h00), tz));
+            __m256 atX1 = _mm256_add_ps(h10, _mm256_mul_ps(_mm256_sub_ps(h11, h10), tz));
+            __m256 h = _mm256_add_ps(atX0, _mm256_mul_ps(_mm256_sub_ps(atX1, atX0), tx));
+            _mm256_storeu_ps(heights + k, _mm256_and_ps(h, inside));
+        }
+#endif
+        for (; k < points.size; k++) {
+            heights[k] = getHeight(points[k].x, points[k].y);
+        }
+    }
+
+    // Sweep the move from `from` to `to` against the bilinear surface, so a
+    // long step cannot pass through a ridge between two points above it.
+    // Walks the grid cells under the move in order (2D DDA), skips those whose
+    // highest corner is below the move and solves for the crossing in the
+    // rest. True, with the first contact in `hit`, if the move starts under
+    // the ground or dips under it. Off the grid the ground is flat at 0, as
+    // getHeight has it.
+    bool sweep(const glm::vec3& from, const glm::vec3& to, GroundHit& hit) const {
+        if (glm::any(glm::isnan(from)) || glm::any(glm::isnan(to))) return false;
+        float half = gridSize / 2.0f;
+        float last = gridSize - 1.0f;
+        glm::vec2 a(from.x + half, from.z + half); // Grid coordinates of `from`
+        glm::vec2 d(to.x - from.x, to.z - from.z);
+        float dy = to.y - from.y;
+
+        float t0 = 0.0f;
+        float t1 = 1.0f;
+        if (!clipToGrid(a, d, t0, t1)) return sweepFlat(from, to, 0.0f, 1.0f, hit);
+        if (t0 > 0.0f && sweepFlat(from, to, 0.0f, t0, hit)) return true;
+
+        // Cells in the order the move crosses them: next* is the t of the next
+        // cell boundary along each axis, every* the t between two of them
+        glm::vec2 start = a + d * t0;
+        int i = std::min((int)start.x, gridSize - 2);
+        int j = std::min((int)start.y, gridSize - 2);
+        int stepI = d.x > 0.0f ? 1 : -1;
+        int stepJ = d.y > 0.0f ? 1 : -1;
+        float nextI = d.x != 0.0f ? ((d.x > 0.0f ? i + 1 : i) - a.x) / d.x : INFINITY;
+        float nextJ = d.y != 0.0f ? ((d.y > 0.0f ? j + 1 : j) - a.y) / d.y : INFINITY;
+        float everyI = d.x != 0.0f ? 1.0f / std::fabs(d.x) : INFINITY;
+        float everyJ = d.y != 0.0f ? 1.0f / std::fabs(d.y) : INFINITY;
+        float ta = t0;
+        while (true) {
+            float tb = std::min(std::min(nextI, nextJ), t1);
+            float t = crossCell(i, j, a, d, from.y, dy, ta, std::max(tb, ta));
+            if (t >= 0.0f) {
+                glm::vec2 at = glm::clamp(a + d * t, glm::vec2(0.0f), glm::vec2(last));
+                float u = at.x - i;
+                float w = at.y - j;
+                const float* h = flatHeights.data() + (size_t)i * gridSize + j;
+                float cxz = h[gridSize + 1] - h[gridSize] - h[1] + h[0];
+                hit.t = t;
+                hit.point = glm::vec3(from.x + (to.x - from.x) * t, interpolate(at.x, at.y), from.z + (to.z - from.z) * t);
+                hit.normal = glm::normalize(glm::vec3(-(h[gridSize] - h[0] + cxz * w), 1.0f, -(h[1] - h[0] + cxz * u)));
+                return true;
+            }
+            if (tb >= t1) break;
+            if (nextI < nextJ) {
+                i += stepI;
+                nextI += everyI;
+            }
+            else {
+                j += stepJ;
+                nextJ += everyJ;
+            }
+            if (i < 0 || i > gridSize - 2 || j < 0 || j > gridSize - 2) break;
+            ta = tb;
+        }
+        return t1 < 1.0f && sweepFlat(from, to, t1, 1.0f, hit);
+    }
+
+    // True if the terrain leaves the straight line from `from` to `to` clear.
+    // Walks the max pyramid down from the smallest squares that cover the
+    // line, skipping every square the line passes above the highest point
+    // of, so a line over open ground costs a few squares rather than one per
+    // cell, and solves for the crossing only in the cells the line dips into.
+    // Nearer squares go first, so a hidden line stops at its first ridge.
+    // Off the grid the ground is flat at 0, as for sweep().
+    bool lineOfSight(const glm::vec3& from, const glm::vec3& to) const {
+        if (glm::any(glm::isnan(from)) || glm::any(glm::isnan(to))) return false;
+        float half = gridSize / 2.0f;
+        glm::vec2 a(from.x + half, from.z + half); // Grid coordinates of `from`
+        glm::vec2 d(to.x - from.x, to.z - from.z);
+        float dy = to.y - from.y;
+        GroundHit hit;
+
+        float t0 = 0.0f;
+        float t1 = 1.0f;
+        if (!clipToGrid(a, d, t0, t1)) return !sweepFlat(from, to, 0.0f, 1.0f, hit);
+        if (t0 > 0.0f && sweepFlat(from, to, 0.0f, t0, hit)) return false;
+        if (t1 < 1.0f && sweepFlat(from, to, t1, 1.0f, hit)) return false;
+
+        // Squares still to look into, as (level, x, z): up to four to start
+        // with, then at most three siblings of every square on the way down
+        struct Square {
+            int level;
+            int i;
+            int j;
+        };
+        Square open[4 + 3 * 32];
+        int waiting = 0;
+
+        // Start at the level whose squares are as wide as the line's extent,
+        // so it covers two of them along each axis at most. Pushed far to
+        // near, as the children are below.
+        glm::vec2 least = glm::min(a + d * t0, a + d * t1);
+        glm::vec2 most = glm::max(a + d * t0, a + d * t1);
+        float extent = std::max(most.x - least.x, most.y - least.y);
+        int level = 0;
+        while (level + 1 < (int)mipStart.size() && (float)(1 << level) < extent) level++;
+        int side = (gridSize - 1) >> level;
+        int firstI = std::min((int)least.x >> level, side - 1);
+        int lastI = std::min((int)most.x >> level, side - 1);
+        int firstJ = std::min((int)least.y >> level, side - 1);
+        int lastJ = std::min((int)most.y >> level, side - 1);
+        int stepI = d.x < 0.0f ? 1 : 0; // Flips the child order where the line runs backward
+        int stepJ = d.y < 0.0f ? 1 : 0;
+        for (int c = 3; c >= 0; c--) {
+            int i = (c >> 1) ^ stepI;
+            int j = (c & 1) ^ stepJ;
+            if (i <= lastI - firstI && j <= lastJ - firstJ) open[waiting++] = Square{ level, firstI + i, firstJ + j };
+        }
+
+        glm::vec2 inverse(d.x != 0.0f ? 1.0f / d.x : 0.0f, d.y != 0.0f ? 1.0f / d.y : 0.0f);
+        while (waiting > 0) {
+            Square s = open[--waiting];
+            int size = 1 << s.level;
+            side = (gridSize - 1) >> s.level;
+
+            // Part of the line over the square
+            float ta = t0;
+            float tb = t1;
+            bool over = true;
+            for (int k = 0; k < 2; k++) {
+                float lower = (float)((k == 0 ? s.i : s.j) * size);
+                float upper = lower + size;
+                if (d[k] == 0.0f) {
+                    over = over && a[k] >= lower && a[k] <= upper;
+                }
+                else {
+                    float enter = (lower - a[k]) * inverse[k];
+                    float exit = (upper - a[k]) * inverse[k];
+                    ta = std::max(ta, std::min(enter, exit));
+                    tb = std::min(tb, std::max(enter, exit));
+                }
+            }
+            if (!over || ta > tb) continue;
+            float top = maxMip[mipStart[s.level] + (size_t)s.i * side + s.j];
+            if (std::min(from.y + dy * ta, from.y + dy * tb) > top) continue; // Above everything in the square
+
+            if (s.level == 0) {
+                if (crossCell(s.i, s.j, a, d, from.y, dy, ta, tb) >= 0.0f) return false;
+                continue;
+            }
+            for (int c = 3; c >= 0; c--) {
+                open[waiting++] = Square{ s.level - 1, 2 * s.i + ((c >> 1) ^ stepI), 2 * s.j + ((c & 1) ^ stepJ) };
+            }
+        }
+        return true;
+    }
+
+    // lineOfSight() for the lines from[k] to to[k], written to
+    // visible[0 .. from.size) as 1 (clear) or 0 (hidden)
+    void lineOfSight(Span<glm::vec3> from, Span<glm::vec3> to, uint8_t* visible) const {
+        for (size_t k = 0; k < from.size; k++) {
+            visible[k] = lineOfSight(from[k], to[k]) ? 1 : 0;
+        }
     }
 };
@@ -1,11 +1,32 @@
 #pragma once
 
+#include <algorithm>
+#include <cmath>
 #include <iostream>
 #include <string>
 #include "Object.h"
 #include "LandMass.h"
+#include "FlowField.h"
+#include "ClearanceField.h"
+#include "MeshBVH.h"
+#include "SimRandom.h"
+#include "SwarmIndex.h"
 #include <glm/gtc/random.hpp> // For random generation
 
+// Everything that defines a bee's simulation state (checkpoints save this)
+struct MemberState {
+    glm::vec3 p;      // Position
+    glm::vec3 v;      // Velocity
+    glm::vec3 a;      // Acceleration
+    glm::vec3 d;      // Direction
+    glm::vec3 h;      // Hive location
+    glm::vec3 color;  // Current color (shows the return state)
+    bool returnHome;  // Carrying pollen back to the hive
+    int pollen;       // Pollen not yet counted by the hive
+    uint64_t rng;     // Random stream position
+    float clearance;  // Distance left before a flower, the hive or the bounds need steering
+};
+
 // Class representing a member (e.g., a bee) in the simulation
 class Member : public Object {
 private:
@@ -16,11 +37,13 @@ private:
     glm::vec3 h; // Hive location - known to bees
     bool returnHome; // Whether the bee should return home
     int pollen; // Amount of pollen collected by the bee
+    SimRandom rng; // Per-bee random stream for flight noise
+    float clearance; // How far the bee can fly before its targets or the bounds pull on it
 
 public:
     // Parameterized Constructor
-    Member(const std::string& objPath, GLuint shaderProgram, const glm::vec3& color, glm::vec3 position)
-        : Object(objPath, shaderProgram, color), p(position), v(1.0, 0.0, 0.0), a(0), d(1), h(position), pollen(0) {
+    Member(const std::string& objPath, GLuint shaderProgram, const glm::vec3& color, glm::vec3 position, uint64_t seed = SimRandom::randomSeed())
+        : Object(objPath, shaderProgram, color), p(position), v(1.0, 0.0, 0.0), a(0), d(1), h(position), pollen(0), rng(seed), clearance(0.0f) {
         modelMatrix = glm::translate(glm::mat4(1.0f), p); // Initialize model matrix with position
         returnHome = false; // Default state: not returning home
     }
@@ -30,7 +53,38 @@ public:
 
     // Update the model matrix for rendering
     void update() {
-        modelMatrix = glm::mat4(1.0f); // Reset model matrix
+        PROFILE_ZONE("Member::update");
+        modelMatrix = modelMatrixFor(p, d);
+    }
+
+    // Distance within which bees push each other apart
+    static float avoidanceRadius() {
+        return 0.5f;
+    }
+
+    // Distance within which bees pull toward the swarm's center and heading
+    static float cohesionRadius() {
+        return 15.0f;
+    }
+
+    // Speed limit, so also the furthest a bee flies in a second
+    static float topSpeed() {
+        return 5.0f;
+    }
+
+    // Distance at which a bee picks up pollen from a flower or drops it at the hive
+    static float interactionRadius() {
+        return 2.0f;
+    }
+
+    // Distance within which a bee notices a flower and makes for it
+    static float senseRadius() {
+        return 10.0f;
+    }
+
+    // Model matrix of a bee at `p` heading along `d` (also used by trajectory replay)
+    static glm::mat4 modelMatrixFor(const glm::vec3& p, const glm::vec3& d) {
+        glm::mat4 modelMatrix = glm::mat4(1.0f); // Reset model matrix
 
         // Apply translation based on position
         modelMatrix = glm::translate(modelMatrix, p);
@@ -54,74 +108,115 @@ public:
             float angle = glm::acos(glm::clamp(glm::dot(defaultDirection, constrainedD), -1.0f, 1.0f));
             modelMatrix = glm::rotate(modelMatrix, angle, rotationAxis);
         }
+        return modelMatrix;
     }
 
-    // Simulate movement with given forces and constraints
-    void move(float deltaTime, std::vector<glm::vec3> ffs, std::vector<glm::vec3> fps, BoundBox bounds, std::vector<std::vector<glm::vec3>> teamPosDir, LandMass land) {
-        const float obstacleRadius = 0.5f;      // Avoidance radius for obstacles
+    // Simulate movement with given forces and constraints. `team` is this
+    // tick's snapshot of the swarm, to flock with and to avoid; `field` leads
+    // it to flowers and home, `flowerInSight` is false when the terrain hides
+    // the flower the field offers, `terrain` keeps it off the ground, `hive`
+    // is the hive's geometry to deliver at and fly around.
+    // Follow with settle() from the old position. True when the bee is close
+    // enough to that flower to collect() from it.
+    bool move(float deltaTime, const SwarmIndex& team, const FlowField& field, bool flowerInSight, const ClearanceField& terrain, const PlacedMesh& hive, const BoundBox& bounds) {
+        PROFILE_ZONE("Member::move");
+        const float obstacleRadius = avoidanceRadius(); // Avoidance radius for obstacles
         const float avoidanceStrength = 2.5f;  // Strength of obstacle avoidance
-        const float maxSpeed = 5.0f;           // Maximum speed
+        const float maxSpeed = topSpeed();     // Maximum speed
         const float noiseScale = 2.0f;         // Random noise scale
-        const float swarmRad = 15.0f;           // Swarm interaction radius
+        const float swarmRad = cohesionRadius(); // Swarm interaction radius
         const float swarmStr = 0.85f;          // Swarm influence strength
-        const float objSense = 10.0f;          // Object sensing radius
-        const float iterRad = 2.0f;            // Interaction radius
+        const float objSense = senseRadius();  // Object sensing radius
+        const float iterRad = interactionRadius(); // Interaction radius
         const float boundRad = 5.0f;           // Boundary radius
         const float contStr = 10.0f;           // Strength of boundary restoring force
+        const float groundGap = 0.25f;         // Clearance below which the ground's and the walls' push stops growing
 
         // Calculate team alignment vectors
-        std::pair<glm::vec3, glm::vec3> avgPair = teamAvg(teamPosDir, swarmRad);
+        std::pair<glm::vec3, glm::vec3> avgPair = teamAvg(team, swarmRad);
         glm::vec3 teamAvgPos = glm::length(avgPair.first) > 0.0f ? glm::normalize(avgPair.first) * swarmStr : glm::vec3(0.0f);
         glm::vec3 teamAvgDir = glm::length(avgPair.second) > 0.0f ? glm::normalize(avgPair.second) * swarmStr : glm::vec3(0.0f);
 
         a = glm::vec3(0.0f); // Reset acceleration
 
         float r; // Distance to obstacle or target
+        glm::vec3 surface; // Nearest point of the hive's geometry
+        bool reached = false; // Within reach of the flower it makes for
 
         if (returnHome) {
             r = glm::length(h - p);
-            a += glm::normalize(h - p) * contStr * 0.75f; // Steer toward hive
+            a += field.homeHeading(p, h) * contStr * 0.75f; // Steer toward hive
+            clearance = std::min(r, hive.boundDistance(p)) - iterRad;
+            if (hive.closestPoint(p, iterRad, surface)) {
+                r = std::min(r, glm::length(surface - p)); // Delivered at the hive's wall, however big it has grown
+            }
             if (r < iterRad) {
                 returnHome = false;
                 color = glm::vec3(1.0f, 0.843f, 0.0f); // Change color to indicate bee is free
                 pollen++; // Deposit pollen
+                clearance = 0.0f; // New target
             }
         }
         else {
-            for (const auto& point : fps) {
-                if (!glm::any(glm::isnan(point))) {
-                    glm::vec3 offset = point - p;
-                    r = glm::length(offset);
-                    if (r < objSense && r != 0) {
-                        a += glm::normalize(offset) * contStr * 0.75f;
-                        if (r < iterRad) {
-                            returnHome = true; // Trigger return to hive
-                            color = glm::vec3(1.0f, 0.5f, 0.0f); // Change color to indicate return state
-                        }
+            FlowField::NearestFlower flower = field.nearestFlower(p);
+            clearance = flower.lowerBound - objSense;
+            if (flower.found && flowerInSight) {
+                glm::vec3 offset = flower.position - p;
+                r = glm::length(offset);
+                if (r < objSense && r != 0) {
+                    a += glm::normalize(offset) * contStr * 0.75f;
+                    if (r < iterRad) {
+                        reached = true; // Its nectar is contested, the caller settles who takes it
+                        clearance = 0.0f; // Steer again next tick, with or without a load
                     }
                 }
             }
         }
 
-        // Avoid obstacles
-        for (const auto& point : ffs) {
-            if (!glm::any(glm::isnan(point))) {
-                glm::vec3 offset = p - point;
-                r = glm::length(offset);
-                if (r < obstacleRadius && r != 0) {
-                    a += (offset / (r * r)) * avoidanceStrength;
-                }
+        // Avoid the other bees
+        team.forEachNear(p, obstacleRadius, [&](size_t k) {
+            glm::vec3 offset = p - team.pos[k];
+            r = glm::length(offset);
+            if (r != 0) {
+                a += (offset / (r * r)) * avoidanceStrength;
+            }
+        });
+
+        // Fly around the hive. Bees hatch inside it and leave through its
+        // wall, so only bees outside (further from the center than the wall)
+        // are pushed off.
+        clearance = std::min(clearance, hive.boundDistance(p) - obstacleRadius);
+        if (hive.closestPoint(p, obstacleRadius, surface)) {
+            glm::vec3 offset = p - surface;
+            r = glm::length(offset);
+            if (r != 0 && glm::dot(offset, surface - h) > 0.0f) {
+                a += (offset / (r * r)) * avoidanceStrength;
             }
         }
 
-        // Add boundary repellent forces
+        // Distance to the band along the bounds and the ground where the
+        // repellent forces act. The ground's is in sampled distance, which
+        // changes by at most steepest() per unit flown.
+        ClearanceField::Sample ground = terrain.sample(p);
+        clearance = std::min(clearance, std::min(p.x - bounds.min.x, bounds.max.x - p.x) - boundRad);
+        clearance = std::min(clearance, bounds.max.y - p.y - boundRad);
+        clearance = std::min(clearance, std::min(p.z - bounds.min.z, bounds.max.z - p.z) - boundRad);
+        clearance = std::min(clearance, (ground.distance - boundRad) / ClearanceField::steepest());
+
+        // Add boundary repellent forces, capped at the walls as the ground's is
+        // at the surface (settle() can leave a bee right on the terrain's edge)
         glm::vec3 boundaryForce(0.0f);
-        if (p.x < bounds.min.x + boundRad) boundaryForce.x += contStr / (p.x - bounds.min.x);
-        if (p.x > bounds.max.x - boundRad) boundaryForce.x -= contStr / (bounds.max.x - p.x);
-        if (p.y < bounds.min.y + boundRad) boundaryForce.y += contStr / (p.y - land.getHeight(p.x, p.z));
-        if (p.y > bounds.max.y - boundRad) boundaryForce.y -= contStr / (bounds.max.y - p.y);
-        if (p.z < bounds.min.z + boundRad) boundaryForce.z += contStr / (p.z - bounds.min.z);
-        if (p.z > bounds.max.z - boundRad) boundaryForce.z -= contStr / (bounds.max.z - p.z);
+        if (p.x < bounds.min.x + boundRad) boundaryForce.x += contStr / std::max(p.x - bounds.min.x, groundGap);
+        if (p.x > bounds.max.x - boundRad) boundaryForce.x -= contStr / std::max(bounds.max.x - p.x, groundGap);
+        if (p.y > bounds.max.y - boundRad) boundaryForce.y -= contStr / std::max(bounds.max.y - p.y, groundGap);
+        if (p.z < bounds.min.z + boundRad) boundaryForce.z += contStr / std::max(p.z - bounds.min.z, groundGap);
+        if (p.z > bounds.max.z - boundRad) boundaryForce.z -= contStr / std::max(bounds.max.z - p.z, groundGap);
+        if (ground.distance < boundRad) {
+            // Away from the ground, as the walls push, but capped at the surface
+            float slope = glm::length(ground.gradient);
+            glm::vec3 away = slope > 0.0f ? ground.gradient / slope : glm::vec3(0.0f, 1.0f, 0.0f);
+            boundaryForce += away * (contStr / std::max(ground.distance, groundGap));
+        }
 
         if (p.x < bounds.min.x || p.x > bounds.max.x
             || p.y > bounds.max.y
@@ -135,7 +230,7 @@ public:
 
         v += a * deltaTime + teamAvgDir; // Update velocity
 
-        glm::vec3 noise = glm::linearRand(glm::vec3(-1.0f), glm::vec3(1.0f)) * noiseScale;
+        glm::vec3 noise = rng.linearRand(glm::vec3(-1.0f), glm::vec3(1.0f)) * noiseScale;
         v += noise; // Add random noise
 
         if (glm::length(v) > maxSpeed) {
@@ -143,13 +238,56 @@ public:
         }
 
         p += v * deltaTime; // Update position
+        d = glm::normalize(v); // Update direction
+        return reached;
+    }
+
+    // Take a load of nectar from the flower move() reached and carry it home
+    void collect() {
+        returnHome = true; // Trigger return to hive
+        color = glm::vec3(1.0f, 0.5f, 0.0f); // Change color to indicate return state
+        clearance = 0.0f; // New target
+    }
+
+    // Cheap tick for a bee in open transit: keep the last steering force and
+    // fly on without the flower scan, flocking, avoidance or noise. Spends the
+    // clearance, so the bee is steered again before anything can pull on it.
+    // Follow with settle(), as move().
+    void coast(float deltaTime) {
+        v += a * deltaTime;
+        float speed = glm::length(v);
+        if (speed > topSpeed()) {
+            v *= topSpeed() / speed;
+            speed = topSpeed();
+        }
+        p += v * deltaTime;
+        d = glm::normalize(v);
+        clearance -= speed * deltaTime;
+    }
 
-        if (p.y < land.getHeight(p.x, p.z)) {
-            p -= v * deltaTime * 2.0f; // Reflect off ground
-            v.y = -v.y;
+    // Finish a move() or coast() against the terrain: sweep the step just
+    // taken from `from`, so it cannot pass through the ground however long it
+    // is, and if it met the ground stop just above the contact and bounce off
+    // the surface. The rest of the step is lost.
+    void settle(const glm::vec3& from, const LandMass& land) {
+        const float lift = 0.01f; // Height above the contact the bee is left at
+        LandMass::GroundHit hit;
+        if (!land.sweep(from, p, hit)) {
+            return;
+        }
+        p = hit.point + hit.normal * lift;
+        float into = glm::dot(v, hit.normal);
+        if (into < 0.0f) {
+            v -= hit.normal * (2.0f * into); // Reflect off the ground
         }
+        d = glm::normalize(v);
+        clearance = 0.0f; // Steer on the next tick
+    }
 
-        d = glm::normalize(v); // Update direction
+    // Distance the bee can still fly before a flower, the hive or the bounds
+    // need its full steering, as of its last move() or coast()
+    float getClearance() const {
+        return clearance;
     }
 
     // Render the member
@@ -177,6 +315,42 @@ public:
         }
     }
 
+    // Copy of the simulation state
+    MemberState getState() const {
+        MemberState s;
+        s.p = p;
+        s.v = v;
+        s.a = a;
+        s.d = d;
+        s.h = h;
+        s.color = color;
+        s.returnHome = returnHome;
+        s.pollen = pollen;
+        s.rng = rng.state;
+        s.clearance = clearance;
+        return s;
+    }
+
+    // Replace the simulation state (checkpoint restore)
+    void setState(const MemberState& s) {
+        p = s.p;
+        v = s.v;
+        a = s.a;
+        d = s.d;
+        h = s.h;
+        color = s.color;
+        returnHome = s.returnHome;
+        pollen = s.pollen;
+        rng.state = s.rng;
+        clearance = s.clearance;
+        update();
+    }
+
+    // Whether the bee is carrying pollen back to the hive
+    bool isReturningHome() const {
+        return returnHome;
+    }
+
     // Retrieve and reset pollen count
     int getPollen() {
         int pln = pollen;
@@ -184,19 +358,10 @@ public:
         return pln;
     }
 
-private:
-    // Calculate team average position and direction within a radius
-    std::pair<glm::vec3, glm::vec3> teamAvg(std::vector<std::vector<glm::vec3>> posDir, float r) {
-        glm::vec3 sumPos(0.0f);
-        glm::vec3 sumDir(0.0f);
-        float size = 0;
-        for (size_t i = 0; i < posDir[0].size(); ++i) {
-            if (glm::length(posDir[0][i] - p) < r) {
-                sumPos += posDir[0][i];
-                sumDir += posDir[1][i];
-                size++;
-            }
-        }
-        return std::make_pair(sumPos / size, sumDir / size); // Return average
+    // Calculate team average position and direction within a radius (Barnes-Hut
+    // approximated when team.theta > 0)
+    std::pair<glm::vec3, glm::vec3> teamAvg(const SwarmIndex& team, float r) {
+        SwarmSums sums = team.sumNear(p, r);
+        return std::make_pair(sums.pos / sums.count, sums.dir / sums.count); // Return average
     }
 };
@@ -0,0 +1,175 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+#include <string>
+
+// Subsystems whose memory is accounted separately
+enum MemoryTag {
+    memoryTerrain = 0,    // Height grid, generated mesh, terrain GPU buffers
+    memoryMeshes = 1,     // Decoded model cache and every Object's GPU buffers
+    memoryMeshDecode = 2, // tinyobj intermediates while a model is parsed
+    memorySwarm = 3,      // Member objects
+    memoryFlowers = 4,    // Flower objects
+    memoryScratch = 5,    // Tick arenas
+    memoryTagCount = 6
+};
+
+inline const char* memoryTagName(int tag) {
+    static const char* names[memoryTagCount] = { "terrain", "meshes", "mesh_decode", "swarm", "flowers", "scratch" };
+    return tag >= 0 && tag < memoryTagCount ? names[tag] : "total";
+}
+
+// Live bytes per subsystem: CPU heap and estimated GPU buffer sizes. Updated
+// with relaxed atomics from any thread, read by telemetry and the budget checks.
+struct MemoryAccounts {
+    std::atomic<long long> cpu[memoryTagCount];     // Live heap bytes
+    std::atomic<long long> gpu[memoryTagCount];     // Live GL buffer bytes (sizes passed to glBufferData)
+    std::atomic<long long> peak[memoryTagCount];    // Highest cpu + gpu seen
+    std::atomic<long long> budget[memoryTagCount + 1]; // Limits in bytes, 0 for none; the last is the total
+
+    MemoryAccounts() {
+        for (int t = 0; t < memoryTagCount; t++) {
+            cpu[t].store(0, std::memory_order_relaxed);
+            gpu[t].store(0, std::memory_order_relaxed);
+            peak[t].store(0, std::memory_order_relaxed);
+        }
+        for (auto& b : budget) b.store(0, std::memory_order_relaxed);
+    }
+
+    long long used(int tag) const {
+        return cpu[tag].load(std::memory_order_relaxed) + gpu[tag].load(std::memory_order_relaxed);
+    }
+
+    long long total() const {
+        long long sum = 0;
+        for (int t = 0; t < memoryTagCount; t++) sum += used(t);
+        return sum;
+    }
+};
+
+// Process-wide accounts
+inline MemoryAccounts& memoryAccounts() {
+    static MemoryAccounts accounts;
+    return accounts;
+}
+
+// Add (or with negative sizes, release) bytes against a subsystem
+inline void memoryCharge(int tag, long long cpuBytes, long long gpuBytes) {
+    MemoryAccounts& m = memoryAccounts();
+    long long c = m.cpu[tag].fetch_add(cpuBytes, std::memory_order_relaxed) + cpuBytes;
+    long long g = m.gpu[tag].fetch_add(gpuBytes, std::memory_order_relaxed) + gpuBytes;
+    long long prev = m.peak[tag].load(std::memory_order_relaxed);
+    while (c + g > prev && !m.peak[tag].compare_exchange_weak(prev, c + g, std::memory_order_relaxed)) {}
+}
+
+// True when the subsystem, or the process as a whole, is past its budget
+inline bool memoryOverBudget(int tag) {
+    MemoryAccounts& m = memoryAccounts();
+    long long limit = m.budget[tag].load(std::memory_order_relaxed);
+    long long totalLimit = m.budget[memoryTagCount].load(std::memory_order_relaxed);
+    return (limit > 0 && m.used(tag) > limit) || (totalLimit > 0 && m.total() > totalLimit);
+}
+
+// Budget in bytes for a subsystem (memoryTagCount for the total), 0 for none
+inline long long memoryBudget(int tag) {
+    return memoryAccounts().budget[tag].load(std::memory_order_relaxed);
+}
+
+// Set budgets from "tag=MB,tag=MB,..." (tags as in memoryTagName, plus "total").
+// False if a tag is unknown.
+inline bool parseMemoryBudgets(const std::string& spec) {
+    size_t start = 0;
+    while (start < spec.size()) {
+        size_t end = spec.find(',', start);
+        if (end == std::string::npos) end = spec.size();
+        std::string item = spec.substr(start, end - start);
+        size_t eq = item.find('=');
+        if (eq == std::string::npos) return false;
+        std::string name = item.substr(0, eq);
+        int tag = -1;
+        for (int t = 0; t <= memoryTagCount; t++) {
+            if (name == memoryTagName(t)) tag = t;
+        }
+        if (tag < 0) return false;
+        double mb = atof(item.c_str() + eq + 1);
+        memoryAccounts().budget[tag].store((long long)(mb * 1024.0 * 1024.0), std::memory_order_relaxed);
+        start = end + 1;
+    }
+    return true;
+}
+
+// Bytes an owner holds against a subsystem. set() moves the charge to new
+// sizes, the destructor releases it, and copies charge their own share.
+class MemoryCharge {
+private:
+    int tag;
+    long long cpuBytes;
+    long long gpuBytes;
+
+public:
+    explicit MemoryCharge(int tag) : tag(tag), cpuBytes(0), gpuBytes(0) {}
+
+    MemoryCharge(const MemoryCharge& other) : tag(other.tag), cpuBytes(0), gpuBytes(0) {
+        set(other.cpuBytes, other.gpuBytes);
+    }
+
+    MemoryCharge& operator=(const MemoryCharge& other) {
+        if (this != &other) {
+            set(0, 0);
+            tag = other.tag;
+            set(other.cpuBytes, other.gpuBytes);
+        }
+        return *this;
+    }
+
+    ~MemoryCharge() {
+        set(0, 0);
+    }
+
+    void set(long long cpu, long long gpu) {
+        if (cpu != cpuBytes || gpu != gpuBytes) {
+            memoryCharge(tag, cpu - cpuBytes, gpu - gpuBytes);
+            cpuBytes = cpu;
+            gpuBytes = gpu;
+        }
+    }
+
+    long long cpu() const { return cpuBytes; }
+    long long gpu() const { return gpuBytes; }
+};
+
+// Heap bytes held by a vector's buffer
+template <typename V>
+inline long long capacityBytes(const V& v) {
+    return (long long)(v.capacity() * sizeof(typename V::value_type));
+}
+
+// Standard allocator that charges a subsystem, e.g. for std::allocate_shared
+template <typename T>
+struct TaggedAllocator {
+    typedef T value_type;
+    int tag;
+
+    explicit TaggedAllocator(int tag) : tag(tag) {}
+    template <typename U>
+    TaggedAllocator(const TaggedAllocator<U>& other) : tag(other.tag) {}
+
+    T* allocate(size_t n) {
+        T* p = static_cast<T*>(::operator new(n * sizeof(T)));
+        memoryCharge(tag, (long long)(n * sizeof(T)), 0);
+        return p;
+    }
+
+    void deallocate(T* p, size_t n) {
+        memoryCharge(tag, -(long long)(n * sizeof(T)), 0);
+        ::operator delete(p);
+    }
+};
+
+template <typename T, typename U>
+inline bool operator==(const TaggedAllocator<T>& a, const TaggedAllocator<U>& b) { return a.tag == b.tag; }
+template <typename T, typename U>
+inline bool operator!=(const TaggedAllocator<T>& a, const TaggedAllocator<U>& b) { return a.tag != b.tag; }
\ No newline at end of file
@@ -0,0 +1,410 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include <glm/glm.hpp>
+#include "MemoryBudget.h"
+
+// Bounding volume hierarchy over a triangle mesh, in model space. Built top
+// down with the binned surface area heuristic, then flattened depth first
+// into 32-byte nodes on 64-byte aligned storage: a node's left child follows
+// it, two nodes share a cache line. Answers closest-point, sphere-overlap and
+// ray queries in logarithmic time. Immutable once built, so one tree serves
+// every instance of a model (see PlacedMesh).
+class MeshBVH {
+public:
+    struct Node {
+        glm::vec3 lower;  // Box minimum
+        uint32_t start;   // Leaf: first triangle. Interior: right child
+        glm::vec3 upper;  // Box maximum
+        uint32_t count;   // Leaf: triangle count. Interior: 0
+    };
+
+    struct Triangle {
+        glm::vec3 a, b, c;
+    };
+
+private:
+    static const int bins = 12;          // SAH candidate splits per axis
+    static const uint32_t leafSize = 4;  // Leaves this small are never split
+    static const uint32_t maxLeaf = 16;  // Leaves this large are always split
+    static const int maxDepth = 64;      // Query stack size; the build stops splitting here
+
+    struct Ref {
+        glm::vec3 lower, upper, centroid;
+        uint32_t triangle;
+    };
+
+    std::vector<Triangle> triangles;     // In leaf order
+    std::unique_ptr<char[]> nodeMemory;  // Backing for `nodes`, over-allocated for alignment
+    Node* nodes;                         // Flattened tree, root first
+    uint32_t nodeCount;
+    MemoryCharge memory;                 // Tree and triangle bytes, charged to the mesh account
+
+    static float area(const glm::vec3& lower, const glm::vec3& upper) {
+        glm::vec3 e = glm::max(upper - lower, glm::vec3(0.0f));
+        return 2.0f * (e.x * e.y + e.y * e.z + e.z * e.x);
+    }
+
+    // Squared distance from `p` to a box, 0 inside it
+    static float boxDistance2(const Node& n, const glm::vec3& p) {
+        glm::vec3 d = glm::max(glm::max(n.lower - p, p - n.upper), glm::vec3(0.0f));
+        return glm::dot(d, d);
+    }
+
+    // Entry distance of a ray into a box, INFINITY on a miss or beyond `limit`
+    static float boxEntry(const Node& n, const glm::vec3& origin, const glm::vec3& inverse, float limit) {
+        glm::vec3 t0 = (n.lower - origin) * inverse;
+        glm::vec3 t1 = (n.upper - origin) * inverse;
+        glm::vec3 low = glm::min(t0, t1);
+        glm::vec3 high = glm::max(t0, t1);
+        float enter = std::max(std::max(low.x, low.y), std::max(low.z, 0.0f));
+        float exit = std::min(std::min(high.x, high.y), std::min(high.z, limit));
+        return enter <= exit ? enter : INFINITY;
+    }
+
+    // Point of triangle abc nearest to p (Ericson, Real-Time Collision Detection 5.1.5)
+    static glm::vec3 closestOnTriangle(const glm::vec3& p, const Triangle& t) {
+        glm::vec3 ab = t.b - t.a, ac = t.c - t.a, ap = p - t.a;
+        float d1 = glm::dot(ab, ap), d2 = glm::dot(ac, ap);
+        if (d1 <= 0.0f && d2 <= 0.0f) return t.a;
+        glm::vec3 bp = p - t.b;
+        float d3 = glm::dot(ab, bp), d4 = glm::dot(ac, bp);
+        if (d3 >= 0.0f && d4 <= d3) return t.b;
+        float vc = d1 * d4 - d3 * d2;
+        if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f) return t.a + ab * (d1 / (d1 - d3));
+        glm::vec3 cp = p - t.c;
+        float d5 = glm::dot(ab, cp), d6 = glm::dot(ac, cp);
+        if (d6 >= 0.0f && d5 <= d6) return t.c;
+        float vb = d5 * d2 - d1 * d6;
+        if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f) return t.a + ac * (d2 / (d2 - d6));
+        float va = d3 * d6 - d5 * d4;
+        if (va <= 0.0f && (d4 - d3) >= 0.0f && (d5 - d6) >= 0.0f) {
+            return t.b + (t.c - t.b) * ((d4 - d3) / ((d4 - d3) + (d5 - d6)));
+        }
+        float denom = 1.0f / (va + vb + vc);
+        return t.a + ab * (vb * denom) + ac * (vc * denom);
+    }
+
+    // Ray parameter of a hit on triangle t (Moller-Trumbore), INFINITY on a miss
+    static float rayTriangle(const glm::vec3& origin, const glm::vec3& dir, const Triangle& t) {
+        glm::vec3 e1 = t.b - t.a, e2 = t.c - t.a;
+        glm::vec3 h = glm::cross(dir, e2);
+        float det = glm::dot(e1, h);
+        if (std::fabs(det) < 1e-12f) return INFINITY;
+        float inv = 1.0f / det;
+        glm::vec3 s = origin - t.a;
+        float u = glm::dot(s, h) * inv;
+        if (u < 0.0f || u > 1.0f) return INFINITY;
+        glm::vec3 q = glm::cross(s, e1);
+        float v = glm::dot(dir, q) * inv;
+        if (v < 0.0f || u + v > 1.0f) return INFINITY;
+        float hit = glm::dot(e2, q) * inv;
+        return hit >= 0.0f ? hit : INFINITY;
+    }
+
+    void build(std::vector<Node>& out, std::vector<Ref>& refs, uint32_t begin, uint32_t end, int depth) {
+        uint32_t index = (uint32_t)out.size();
+        out.push_back(Node());
+        Node node;
+        node.lower = glm::vec3(INFINITY);
+        node.upper = glm::vec3(-INFINITY);
+        glm::vec3 centroidLower(INFINITY), centroidUpper(-INFINITY);
+        for (uint32_t k = begin; k < end; k++) {
+            node.lower = glm::min(node.lower, refs[k].lower);
+            node.upper = glm::max(node.upper, refs[k].upper);
+            centroidLower = glm::min(centroidLower, refs[k].centroid);
+            centroidUpper = glm::max(centroidUpper, refs[k].centroid);
+        }
+        uint32_t count = end - begin;
+
+        // Cheapest binned split over the three axes
+        int bestAxis = -1;
+        int bestBin = 0;
+        float bestCost = INFINITY;
+        glm::vec3 extent = centroidUpper - centroidLower;
+        if (count > leafSize && depth < maxDepth - 1) {
+            for (int axis = 0; axis < 3; axis++) {
+                if (!(extent[axis] > 0.0f)) continue;
+                uint32_t binCount[bins] = {};
+                glm::vec3 binLower[bins], binUpper[bins];
+                for (int b = 0; b < bins; b++) {
+                    binLower[b] = glm::vec3(INFINITY);
+                    binUpper[b] = glm::vec3(-INFINITY);
+                }
+                float toBin = bins / extent[axis];
+                for (uint32_t k = begin; k < end; k++) {
+                    int b = std::min((int)((refs[k].centroid[axis] - centroidLower[axis]) * toBin), bins - 1);
+                    binCount[b]++;
+                    binLower[b] = glm::min(binLower[b], refs[k].lower);
+                    binUpper[b] = glm::max(binUpper[b], refs[k].upper);
+                }
+                // Areas and counts left of each split, swept from both ends
+                float leftArea[bins - 1];
+                uint32_t leftCount[bins - 1];
+                glm::vec3 lower(INFINITY), upper(-INFINITY);
+                uint32_t sum = 0;
+                for (int b = 0; b < bins - 1; b++) {
+                    lower = glm::min(lower, binLower[b]);
+                    upper = glm::max(upper, binUpper[b]);
+                    sum += binCount[b];
+                    leftArea[b] = area(lower, upper);
+                    leftCount[b] = sum;
+                }
+                lower = glm::vec3(INFINITY);
+                upper = glm::vec3(-INFINITY);
+                sum = 0;
+                for (int b = bins - 1; b > 0; b--) {
+                    lower = glm::min(lower, binLower[b]);
+                    upper = glm::max(upper, binUpper[b]);
+                    sum += binCount[b];
+                    if (leftCount[b - 1] == 0 || sum == 0) continue;
+                    float cost = leftArea[b - 1] * leftCount[b - 1] + area(lower, upper) * sum;
+                    if (cost < bestCost) {
+                        bestCost = cost;
+                        bestAxis = axis;
+                        bestBin = b;
+                    }
+                }
+            }
+        }
+
+        // Split when it beats intersecting every triangle here, or the leaf is too big
+        float leafCost = area(node.lower, node.upper) * count;
+        if (bestAxis < 0 || (bestCost >= leafCost && count <= maxLeaf)) {
+            node.start = begin;
+            node.count = count;
+            out[index] = node;
+            return;
+        }
+        float toBin = bins / extent[bestAxis];
+        Ref* middle = std::partition(refs.data() + begin, refs.data() + end, [&](const Ref& r) {
+            return std::min((int)((r.centroid[bestAxis] - centroidLower[bestAxis]) * toBin), bins - 1) < bestBin;
+        });
+        uint32_t split = (uint32_t)(middle - refs.data());
+        build(out, refs, begin, split, depth + 1);
+        node.start = (uint32_t)out.size(); // Right child
+        node.count = 0;
+        build(out, refs, split, end, depth + 1);
+        out[index] = node;
+    }
+
+public:
+    // Tree over the triangles `indices` makes of the xyz `vertices`
+    MeshBVH(const std::vector<float>& vertices, const std::vector<unsigned int>& indices)
+        : nodes(nullptr), nodeCount(0), memory(memoryMeshes) {
+        std::vector<Ref> refs;
+        std::vector<Triangle> source;
+        refs.reserve(indices.size() / 3);
+        source.reserve(indices.size() / 3);
+        for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+            Triangle t;
+            t.a = glm::vec3(vertices[indices[i] * 3], vertices[indices[i] * 3 + 1], vertices[indices[i] * 3 + 2]);
+            t.b = glm::vec3(vertices[indices[i + 1] * 3], vertices[indices[i + 1] * 3 + 1], vertices[indices[i + 1] * 3 + 2]);
+            t.c = glm::vec3(vertices[indices[i + 2] * 3], vertices[indices[i + 2] * 3 + 1], vertices[indices[i + 2] * 3 + 2]);
+            Ref r;
+            r.lower = glm::min(t.a, glm::min(t.b, t.c));
+            r.upper = glm::max(t.a, glm::max(t.b, t.c));
+            r.centroid = (r.lower + r.upper) * 0.5f;
+            r.triangle = (uint32_t)source.size();
+            refs.push_back(r);
+            source.push_back(t);
+        }
+
+        std::vector<Node> tree;
+        if (!refs.empty()) {
+            tree.reserve(2 * refs.size());
+            build(tree, refs, 0, (uint32_t)refs.size(), 0);
+        }
+        triangles.resize(refs.size());
+        for (size_t k = 0; k < refs.size(); k++) {
+            triangles[k] = source[refs[k].triangle];
+        }
+
+        nodeCount = (uint32_t)tree.size();
+        nodeMemory.reset(new char[nodeCount * sizeof(Node) + 63]);
+        nodes = reinterpret_cast<Node*>(((uintptr_t)nodeMemory.get() + 63) & ~(uintptr_t)63);
+        std::copy(tree.begin(), tree.end(), nodes);
+        memory.set((long long)(nodeCount * sizeof(Node) + 63) + capacityBytes(triangles), 0);
+    }
+
+    MeshBVH(const MeshBVH&) = delete;
+    MeshBVH& operator=(const MeshBVH&) = delete;
+
+    bool empty() const {
+        return nodeCount == 0;
+    }
+
+    uint32_t size() const {
+        return nodeCount;
+    }
+
+    // Distance from `p` to the mesh's bounding box: never more than to the mesh
+    float boundDistance(const glm::vec3& p) const {
+        return empty() ? INFINITY : std::sqrt(boxDistance2(nodes[0], p));
+    }
+
+    // Point of the mesh nearest to `p`, if one is within `maxDistance`
+    bool closestPoint(const glm::vec3& p, float maxDistance, glm::vec3& nearest) const {
+        if (empty()) return false;
+        float best2 = maxDistance * maxDistance;
+        bool found = false;
+        uint32_t stack[maxDepth];
+        int top = 0;
+        uint32_t n = 0;
+        if (boxDistance2(nodes[0], p) > best2) return false;
+        while (true) {
+            const Node& node = nodes[n];
+            if (node.count > 0) {
+                for (uint32_t k = node.start; k < node.start + node.count; k++) {
+                    glm::vec3 q = closestOnTriangle(p, triangles[k]);
+                    glm::vec3 d = q - p;
+                    float d2 = glm::dot(d, d);
+                    if (d2 <= best2) {
+                        best2 = d2;
+                        nearest = q;
+                        found = true;
+                    }
+                }
+            }
+            else {
+                // Visit the nearer child first, keep the other if it can still hold a closer point
+                uint32_t first = n + 1, second = node.start;
+                float firstD2 = boxDistance2(nodes[first], p);
+                float secondD2 = boxDistance2(nodes[second], p);
+                if (secondD2 < firstD2) {
+                    std::swap(first, second);
+                    std::swap(firstD2, secondD2);
+                }
+                if (secondD2 <= best2) stack[top++] = second;
+                if (firstD2 <= best2) {
+                    n = first;
+                    continue;
+                }
+            }
+            // Pop, skipping subtrees a closer hit has since ruled out
+            while (top > 0 && boxDistance2(nodes[stack[top - 1]], p) > best2) top--;
+            if (top == 0) break;
+            n = stack[--top];
+        }
+        return found;
+    }
+
+    // Whether any triangle comes within `radius` of `center`
+    bool overlapsSphere(const glm::vec3& center, float radius) const {
+        if (empty()) return false;
+        float r2 = radius * radius;
+        uint32_t stack[maxDepth];
+        int top = 0;
+        stack[top++] = 0;
+        while (top > 0) {
+            const Node& node = nodes[stack[--top]];
+            if (boxDistance2(node, center) > r2) continue;
+            if (node.count > 0) {
+                for (uint32_t k = node.start; k < node.start + node.count; k++) {
+                    glm::vec3 d = closestOnTriangle(center, triangles[k]) - center;
+                    if (glm::dot(d, d) <= r2) return true;
+                }
+            }
+            else {
+                stack[top++] = node.start;
+                stack[top++] = (uint32_t)(&node - nodes) + 1;
+            }
+        }
+        return false;
+    }
+
+    // Nearest hit of the ray origin + t * dir, 0 <= t <= maxDistance (t in
+    // units of dir's length)
+    bool raycast(const glm::vec3& origin, const glm::vec3& dir, float maxDistance, float& hit) const {
+        if (empty()) return false;
+        glm::vec3 inverse = 1.0f / dir;
+        float best = maxDistance;
+        bool found = false;
+        uint32_t stack[maxDepth];
+        int top = 0;
+        if (boxEntry(nodes[0], origin, inverse, best) == INFINITY) return false;
+        stack[top++] = 0;
+        while (top > 0) {
+            const Node& node = nodes[stack[--top]];
+            if (node.count > 0) {
+                for (uint32_t k = node.start; k < node.start + node.count; k++) {
+                    float t = rayTriangle(origin, dir, triangles[k]);
+                    if (t <= best && t != INFINITY) {
+                        best = t;
+                        found = true;
+                    }
+                }
+                continue;
+            }
+            // Push the farther child first so the nearer one is searched first
+            uint32_t first = (uint32_t)(&node - nodes) + 1, second = node.start;
+            float firstT = boxEntry(nodes[first], origin, inverse, best);
+            float secondT = boxEntry(nodes[second], origin, inverse, best);
+            if (secondT < firstT) {
+                std::swap(first, second);
+                std::swap(firstT, secondT);
+            }
+            if (secondT != INFINITY) stack[top++] = second;
+            if (firstT != INFINITY) stack[top++] = first;
+        }
+        if (found) hit = best;
+        return found;
+    }
+};
+
+// A MeshBVH placed in the world by a model matrix of rotation, translation
+// and uniform scale. Queries map into model space and results back out.
+class PlacedMesh {
+private:
+    const MeshBVH* bvh;  // Null for no mesh: every query misses
+    glm::mat4 toWorld;   // Model matrix
+    glm::mat4 toModel;   // Its inverse
+    float scale;         // World units per model unit
+
+public:
+    PlacedMesh() : bvh(nullptr), toWorld(1.0f), toModel(1.0f), scale(1.0f) {}
+
+    PlacedMesh(const MeshBVH* bvh, const glm::mat4& modelMatrix) : bvh(bvh) {
+        place(modelMatrix);
+    }
+
+    void place(const glm::mat4& modelMatrix) {
+        toWorld = modelMatrix;
+        toModel = glm::inverse(modelMatrix);
+        scale = glm::length(glm::vec3(modelMatrix[0]));
+    }
+
+    // Distance from `p` to the mesh's bounds, a lower bound on the distance to the mesh
+    float boundDistance(const glm::vec3& p) const {
+        if (bvh == nullptr || bvh->empty()) return INFINITY;
+        return bvh->boundDistance(glm::vec3(toModel * glm::vec4(p, 1.0f))) * scale;
+    }
+
+    bool closestPoint(const glm::vec3& p, float maxDistance, glm::vec3& nearest) const {
+        glm::vec3 local;
+        if (bvh == nullptr || !bvh->closestPoint(glm::vec3(toModel * glm::vec4(p, 1.0f)), maxDistance / scale, local)) {
+            return false;
+        }
+        nearest = glm::vec3(toWorld * glm::vec4(local, 1.0f));
+        return true;
+    }
+
+    bool overlapsSphere(const glm::vec3& center, float radius) const {
+        return bvh != nullptr && bvh->overlapsSphere(glm::vec3(toModel * glm::vec4(center, 1.0f)), radius / scale);
+    }
+
+    // Nearest hit along origin + t * dir, with dir of unit length and t in world units
+    bool raycast(const glm::vec3& origin, const glm::vec3& dir, float maxDistance, float& hit) const {
+        float local;
+        glm::vec3 localDir = glm::vec3(toModel * glm::vec4(dir, 0.0f)) * scale; // Unit length in model space
+        if (bvh == nullptr || !bvh->raycast(glm::vec3(toModel * glm::vec4(origin, 1.0f)), localDir, maxDistance / scale, local)) {
+            return false;
+        }
+        hit = local * scale;
+        return true;
+    }
+};
\ No newline at end of file
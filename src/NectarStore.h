@@ -0,0 +1,147 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "MemoryBudget.h"
+
+// Nectar held by each flower, taken by bees one load at a time and refilled
+// over time. Claims are settled in two phases through one word per flower,
+// so the bees of a tick may claim from any number of threads without locks
+// and the outcome never depends on the order they ran in:
+//  - reserve(): a bee that reached a flower folds its priority into the
+//    flower's word with compare-and-swap, which keeps the lowest priority
+//    and counts the claimants.
+//  - collect(), after every reserve() of the tick: the bee holding the
+//    flower's lowest priority takes a load if there is one. No other bee
+//    touches that flower's nectar, so this needs no atomics either.
+//  - endTick(), on one thread: counts the claimants that lost as contention
+//    and clears the words for the next tick.
+// Flowers are indexed oldest first, as Simulation keeps them.
+class NectarStore {
+private:
+    static const uint64_t unclaimed = 0xFFFFFFFF00000000ull; // No claimants: the last priority and a count of 0
+
+    float fullLoads;                  // Loads a full flower holds, 0 or less for no limit
+    float refillRate;                 // Loads a flower regains per second
+    std::vector<float> loads;         // Nectar left in each flower, fractional while it refills
+    std::vector<uint32_t> contention; // Claims each flower has turned away for another bee
+    std::unique_ptr<std::atomic<uint64_t>[]> claims; // This tick's claims on each flower: lowest priority in the high half, claimant count in the low
+    size_t claimSlots;                // Length of claims
+    MemoryCharge memory;              // Charged to the flower account
+
+    // Room in claims for every flower. Only grows, so a colony with a steady
+    // flower count never reallocates.
+    void fit() {
+        if (loads.size() > claimSlots) {
+            claimSlots = std::max(loads.size(), claimSlots * 2);
+            claims.reset(new std::atomic<uint64_t>[claimSlots]);
+            for (size_t f = 0; f < claimSlots; f++) claims[f].store(unclaimed, std::memory_order_relaxed);
+        }
+        memory.set(capacityBytes(loads) + capacityBytes(contention) + (long long)(claimSlots * sizeof(std::atomic<uint64_t>)), 0);
+    }
+
+public:
+    NectarStore(float fullLoads, float refillSeconds)
+        : claimSlots(0), memory(memoryFlowers) {
+        setLimits(fullLoads, refillSeconds);
+    }
+
+    // Loads a full flower holds, 0 or less for no limit, and the time one
+    // load takes to refill
+    void setLimits(float full, float refillSeconds) {
+        fullLoads = full;
+        refillRate = refillSeconds > 0.0f ? 1.0f / refillSeconds : 0.0f;
+    }
+
+    size_t size() const {
+        return loads.size();
+    }
+
+    void clear() {
+        loads.clear();
+        contention.clear();
+        fit();
+    }
+
+    // A new flower opens, full, after the others
+    void bloom() {
+        loads.push_back(std::max(fullLoads, 0.0f));
+        contention.push_back(0);
+        fit();
+    }
+
+    // The oldest flower withers
+    void wither() {
+        if (loads.empty()) return;
+        loads.erase(loads.begin());
+        contention.erase(contention.begin());
+    }
+
+    // Every flower regains nectar for `seconds`, up to full
+    void refill(float seconds) {
+        if (!(seconds > 0.0f) || fullLoads <= 0.0f) return;
+        for (float& l : loads) l = std::min(l + refillRate * seconds, fullLoads);
+    }
+
+    // Loads left in `flower`
+    float nectar(size_t flower) const {
+        return loads[flower];
+    }
+
+    // Restore the nectar of `flower` (checkpoints)
+    void setNectar(size_t flower, float nectar) {
+        loads[flower] = nectar;
+    }
+
+    // Claims `flower` turned away since it opened
+    uint32_t contended(size_t flower) const {
+        return contention[flower];
+    }
+
+    // Most claims any living flower has turned away
+    uint32_t busiest() const {
+        return contention.empty() ? 0 : *std::max_element(contention.begin(), contention.end());
+    }
+
+    // Phase 1: a bee with `priority`, unique among this tick's claimants and
+    // lower to win, claims a load of `flower`. Safe from any thread.
+    void reserve(size_t flower, uint32_t priority) {
+        std::atomic<uint64_t>& word = claims[flower];
+        uint64_t seen = word.load(std::memory_order_relaxed);
+        uint64_t claimed;
+        do {
+            uint32_t lowest = std::min((uint32_t)(seen >> 32), priority);
+            claimed = ((uint64_t)lowest << 32) | ((seen & 0xFFFFFFFFull) + 1);
+        } while (!word.compare_exchange_weak(seen, claimed, std::memory_order_relaxed));
+    }
+
+    // Phase 2, once every reserve() of the tick is done (the join between the
+    // phases orders the words): true if the bee with `priority` won `flower`
+    // and took a load from it. Safe from any thread.
+    bool collect(size_t flower, uint32_t priority) {
+        uint64_t word = claims[flower].load(std::memory_order_relaxed);
+        if ((uint32_t)(word >> 32) != priority) return false; // Another bee came first
+        if (fullLoads <= 0.0f) return true;                    // No limit
+        if (loads[flower] < 1.0f) return false;                // Empty until it refills
+        loads[flower] -= 1.0f;
+        return true;
+    }
+
+    // Phase 3, on one thread: count this tick's lost claims against their
+    // flowers and clear the claims. Returns how many claims were lost.
+    long long endTick() {
+        long long lost = 0;
+        for (size_t f = 0; f < loads.size(); f++) {
+            uint64_t word = claims[f].load(std::memory_order_relaxed);
+            if (word == unclaimed) continue;
+            uint32_t losers = (uint32_t)(word & 0xFFFFFFFFull) - 1;
+            contention[f] += losers;
+            lost += losers;
+            claims[f].store(unclaimed, std::memory_order_relaxed);
+        }
+        return lost;
+    }
+};
\ No newline at end of file
@@ -10,19 +10,41 @@
 #include <glm/gtc/type_ptr.hpp>
 #include "shaders.h"
 #include "tiny_obj_loader.h"
+#include "VertexPacking.h"
+#include "Profiler.h"
+#include "Telemetry.h"
+#include "MemoryBudget.h"
+#include "MeshBVH.h"
 #include <vector>
 #include <iostream>
 #include <string>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <fcntl.h>
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <io.h>
+#ifdef EMBED_MESHES
+#include "generated/EmbeddedMeshes.h" // Written by embed_meshes at build time
+#endif
 
 struct BoundBox {
     glm::vec3 min; // Minimum corner (e.g., bottom-left-back)
     glm::vec3 max; // Maximum corner (e.g., top-right-front)
 };
 
+// Decoded mesh data shared by every Object loaded from the same model
+struct MeshData {
+    std::vector<GLfloat> vertices;      // xyz positions
+    std::vector<GLfloat> normals;       // xyz normals
+    std::vector<GLuint> indices;        // Triangle indices
+    std::vector<PackedVertex> packed;   // Compressed vertices ready for upload
+    std::vector<GLushort> shortIndices; // 16-bit indices, empty if the mesh needs 32-bit
+    QuantizeParams quantize;            // Dequantization scale/offset for the packed positions
+    MemoryCharge memory = MemoryCharge(memoryMeshes); // Bytes held by the arrays above
+};
+
 // Class for managing a single renderable object
 class Object {
 public:
@@ -30,34 +52,133 @@ public:
     GLuint VBO;                // Vertex Buffer Object
     GLuint EBO;                // Element Buffer Object
     GLuint program;            // Shader program
-    GLfloat* vertices;
-    GLfloat* normals;
-    GLuint* indices;
+    std::shared_ptr<const MeshData> mesh; // Decoded mesh, shared between instances
     int triangleCount;         // Number of triangles
+    GLenum indexType;          // GL_UNSIGNED_SHORT when the mesh fits, else GL_UNSIGNED_INT
+    QuantizeParams quantize;   // Dequantization scale/offset for the packed positions
     glm::mat4 modelMatrix;     // Model transformation matrix
     glm::vec3 color;           // Object color
+    MemoryCharge gpuMemory;    // This instance's GL buffers
 
 
     // Constructor
     Object(const std::string& objPath, GLuint shaderProgram, const glm::vec3& color)
-        : VAO(0), VBO(0), EBO(0), program(shaderProgram), triangleCount(0), modelMatrix(1.0f), color(color) {
+        : VAO(0), VBO(0), EBO(0), program(shaderProgram), triangleCount(0), indexType(GL_UNSIGNED_INT),
+        modelMatrix(1.0f), color(color), gpuMemory(memoryMeshes) {
         init(objPath);
     }
 
     // Destructor to clean up resources
     ~Object() {
-        glDeleteBuffers(1, &VBO);
-        glDeleteBuffers(1, &EBO);
-        glDeleteVertexArrays(1, &VAO);
-        delete[] vertices;
-        delete[] normals;
-        delete[] indices;
+        if (VAO != 0) {
+            glDeleteBuffers(1, &VBO);
+            glDeleteBuffers(1, &EBO);
+            glDeleteVertexArrays(1, &VAO);
+        }
     }
 
-    // Load OBJ file and set up buffers
+    // When set, objects load their mesh but create no GL resources and draw nothing.
+    // Used by the benchmarks and other tools that run the simulation without a window.
+    static bool& headless() {
+        static bool enabled = false;
+        return enabled;
+    }
+
+    // Load (or reuse) the decoded model and set up buffers
     void init(const std::string& objPath) {
-        std::vector<tinyobj::shape_t> shapes;
-        std::vector<tinyobj::material_t> materials;
+        mesh = loadMesh(objPath);
+        if (mesh && !headless()) {
+            upload();
+        }
+    }
+
+    // Decode a model from its .bin (or .obj) file. Thread-safe and cached, so
+    // every model is read from disk once and may be decoded on a worker thread.
+    static std::shared_ptr<const MeshData> loadMesh(const std::string& objPath) {
+        static std::mutex cacheMutex;
+        static std::map<std::string, std::shared_ptr<const MeshData>> cache;
+        {
+            std::lock_guard<std::mutex> lock(cacheMutex);
+            auto it = cache.find(objPath);
+            if (it != cache.end()) {
+                return it->second;
+            }
+        }
+
+        std::shared_ptr<MeshData> data = decodeMesh(objPath);
+        if (!data) {
+            return nullptr;
+        }
+
+        std::lock_guard<std::mutex> lock(cacheMutex);
+        auto inserted = cache.insert(std::make_pair(objPath, std::shared_ptr<const MeshData>(data)));
+        return inserted.first->second; // Another thread may have decoded it first
+    }
+
+    // Bounding volume hierarchy over a model's triangles in model space, for
+    // collision queries. Thread-safe and cached like loadMesh(); null if the
+    // model fails to load.
+    static std::shared_ptr<const MeshBVH> loadBVH(const std::string& objPath) {
+        static std::mutex cacheMutex;
+        static std::map<std::string, std::shared_ptr<const MeshBVH>> cache;
+        {
+            std::lock_guard<std::mutex> lock(cacheMutex);
+            auto it = cache.find(objPath);
+            if (it != cache.end()) {
+                return it->second;
+            }
+        }
+
+        std::shared_ptr<const MeshData> data = loadMesh(objPath);
+        if (!data) {
+            return nullptr;
+        }
+        auto bvh = std::make_shared<const MeshBVH>(data->vertices, data->indices);
+
+        std::lock_guard<std::mutex> lock(cacheMutex);
+        auto inserted = cache.insert(std::make_pair(objPath, bvh));
+        return inserted.first->second;
+    }
+
+    // Create the GL objects for the decoded mesh (main thread only)
+    void upload() {
+        triangleCount = (int)mesh->indices.size() / 3;
+        quantize = mesh->quantize;
+
+        // Generate and bind VAO
+        glGenVertexArrays(1, &VAO);
+        glBindVertexArray(VAO);
+
+        // Upload data to GPU
+        glGenBuffers(1, &VBO);
+        glBindBuffer(GL_ARRAY_BUFFER, VBO);
+        glBufferData(GL_ARRAY_BUFFER, mesh->packed.size() * sizeof(PackedVertex), mesh->packed.data(), GL_STATIC_DRAW);
+        long long bufferBytes = (long long)(mesh->packed.size() * sizeof(PackedVertex));
+
+        glGenBuffers(1, &EBO);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+        if (!mesh->shortIndices.empty()) {
+            indexType = GL_UNSIGNED_SHORT;
+            glBufferData(GL_ELEMENT_ARRAY_BUFFER, mesh->shortIndices.size() * sizeof(GLushort), mesh->shortIndices.data(), GL_STATIC_DRAW);
+            bufferBytes += (long long)(mesh->shortIndices.size() * sizeof(GLushort));
+        }
+        else {
+            indexType = GL_UNSIGNED_INT;
+            glBufferData(GL_ELEMENT_ARRAY_BUFFER, mesh->indices.size() * sizeof(GLuint), mesh->indices.data(), GL_STATIC_DRAW);
+            bufferBytes += (long long)(mesh->indices.size() * sizeof(GLuint));
+        }
+        gpuMemory.set(0, bufferBytes);
+
+        // Link vertex attributes
+        bindPackedAttributes(program);
+
+        // Unbind VAO
+        glBindVertexArray(0);
+    }
+
+    // Read the model from disk and pack it for upload (no GL calls, not cached)
+    static std::shared_ptr<MeshData> decodeMesh(const std::string& objPath) {
+        std::shared_ptr<MeshData> data = std::make_shared<MeshData>();
         int nv;
         int nn;
         int ni;
@@ -66,36 +187,50 @@ public:
         int result;
         struct _stat buf;
 
-        // Generate and bind VAO
-        glGenVertexArrays(1, &VAO);
-        glBindVertexArray(VAO);
-        
         std::string binFPath ="src/" + objPath + ".bin";
         std::string objFPath ="src/" + objPath + ".obj";
 
-        result = _stat(binFPath.c_str(), &buf);
-
-        if (result == 0) {
+#ifdef EMBED_MESHES
+        // Models baked into the executable never touch the file system
+        const embedded::EmbeddedMesh* baked = nullptr;
+        for (i = 0; i < embedded::meshCount; i++) {
+            if (objPath == embedded::meshes[i].name) {
+                baked = &embedded::meshes[i];
+            }
+        }
+        if (baked != nullptr) {
+            nv = baked->vertexCount;
+            nn = baked->normalCount;
+            ni = baked->indexCount;
+            data->vertices.assign(baked->vertices, baked->vertices + nv);
+            data->normals.assign(baked->normals, baked->normals + nn);
+            data->indices.assign(baked->indices, baked->indices + ni);
+        }
+        else
+#endif
+        if ((result = _stat(binFPath.c_str(), &buf)) == 0) {
             // Binary file exists, load it
             fid = _open(binFPath.c_str(), _O_RDONLY | _O_BINARY);
             if (fid == -1) {
                 std::cerr << "Failed to open binary file: " << binFPath << std::endl;
-                return;
+                return nullptr;
             }
 
             // Read data from the binary file
 
-            result = _read(fid, &nv, (sizeof vertices));
-            result = _read(fid, &nn, (sizeof normals));
-            result = _read(fid, &ni, (sizeof indices));
-            triangleCount = ni / 3;
-
-            vertices = new GLfloat[nv];
-            result = _read(fid, vertices, nv * (sizeof GLfloat));
-            normals = new GLfloat[nn];
-            result = _read(fid, normals, nn * (sizeof GLfloat));
-            indices = new GLuint[ni];
-            result = _read(fid, indices, ni * (sizeof GLuint));
+            // Header is three counts, each stored in an 8-byte slot
+            GLint header[6];
+            result = _read(fid, header, sizeof(header));
+            nv = header[0];
+            nn = header[2];
+            ni = header[4];
+
+            data->vertices.resize(nv);
+            result = _read(fid, data->vertices.data(), nv * sizeof(GLfloat));
+            data->normals.resize(nn);
+            result = _read(fid, data->normals.data(), nn * sizeof(GLfloat));
+            data->indices.resize(ni);
+            result = _read(fid, data->indices.data(), ni * sizeof(GLuint));
             _close(fid);
 
         }
@@ -108,77 +243,77 @@ public:
 
             if (!err.empty()) {
                 std::cerr << err << std::endl;
-                return;
+                return nullptr;
             }
-            
-            /*  Retrieve the vertex coordinate data */
 
-            nv = (int)shapes[0].mesh.positions.size();
-            vertices = new GLfloat[nv];
-            for (i = 0; i < nv; i++) {
-                vertices[i] = shapes[0].mesh.positions[i];
+            // The parsed shapes are the largest transient allocation of a load
+            MemoryCharge parsed(memoryMeshDecode);
+            long long parsedBytes = 0;
+            for (const auto& shape : shapes) {
+                parsedBytes += capacityBytes(shape.mesh.positions) + capacityBytes(shape.mesh.normals)
+                    + capacityBytes(shape.mesh.texcoords) + capacityBytes(shape.mesh.indices) + capacityBytes(shape.mesh.material_ids);
             }
+            parsed.set(parsedBytes, 0);
+
+            /*  Retrieve the vertex coordinate data */
+
+            data->vertices = shapes[0].mesh.positions;
+            nv = (int)data->vertices.size();
 
             /*  Retrieve the vertex normals */
 
-            nn = (int)shapes[0].mesh.normals.size();
-            normals = new GLfloat[nn];
-            for (i = 0; i < nn; i++) {
-                normals[i] = shapes[0].mesh.normals[i];
-            }
+            data->normals = shapes[0].mesh.normals;
+            nn = (int)data->normals.size();
 
             /*  Retrieve the triangle indices */
 
-            ni = (int)shapes[0].mesh.indices.size();
-            triangleCount = ni / 3;
-            indices = new GLuint[ni];
-            for (i = 0; i < ni; i++) {
-                indices[i] = shapes[0].mesh.indices[i];
-            }
+            data->indices.assign(shapes[0].mesh.indices.begin(), shapes[0].mesh.indices.end());
+            ni = (int)data->indices.size();
 
             // save the binary version of the model
 
             fid = _open(binFPath.c_str(), _O_WRONLY | _O_BINARY | _O_CREAT, _S_IREAD | _S_IWRITE);
 
-            result = _write(fid, &nv, (sizeof vertices));
-            result = _write(fid, &nn, (sizeof normals));
-            result = _write(fid, &ni, (sizeof indices));
+            GLint header[6] = { nv, 0, nn, 0, ni, 0 };
+            result = _write(fid, header, sizeof(header));
 
-            result = _write(fid, vertices, nv * (sizeof GLfloat));
-            result = _write(fid, normals, nn * (sizeof GLfloat));
-            result = _write(fid, indices, ni * (sizeof GLuint));
+            result = _write(fid, data->vertices.data(), nv * sizeof(GLfloat));
+            result = _write(fid, data->normals.data(), nn * sizeof(GLfloat));
+            result = _write(fid, data->indices.data(), ni * sizeof(GLuint));
 
             _close(fid);
         }
 
-        // Upload data to GPU
-        glGenBuffers(1, &VBO);
-        glBindBuffer(GL_ARRAY_BUFFER, VBO);
-        glBufferData(GL_ARRAY_BUFFER, (nv + nn) * sizeof(GLfloat), nullptr, GL_STATIC_DRAW);
-        glBufferSubData(GL_ARRAY_BUFFER, 0, nv * sizeof(GLfloat), vertices);
-        glBufferSubData(GL_ARRAY_BUFFER, nv * sizeof(GLfloat), nn * sizeof(GLfloat), normals);
-
-        glGenBuffers(1, &EBO);
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, ni * sizeof(GLuint), indices, GL_STATIC_DRAW);
-
-        // Link vertex attributes
-        GLint vPosition = glGetAttribLocation(program, "vPosition");
-        glVertexAttribPointer(vPosition, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(GLfloat), reinterpret_cast<void*>(0));
-        glEnableVertexAttribArray(vPosition);
-
-        GLint vNormal = glGetAttribLocation(program, "vNormal");
-        glVertexAttribPointer(vNormal, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(GLfloat), reinterpret_cast<void*>(nv * sizeof(GLfloat)));
-        glEnableVertexAttribArray(vNormal);
+        // Pack positions and normals into the compressed interleaved layout
+        const std::vector<GLfloat>& vertices = data->vertices;
+        const std::vector<GLfloat>& normals = data->normals;
+        int vertexCount = nv / 3;
+        data->quantize = computeQuantizeParams(vertices.data(), vertexCount);
+        data->packed.resize(vertexCount);
+        for (i = 0; i < vertexCount; i++) {
+            glm::vec3 position(vertices[i * 3], vertices[i * 3 + 1], vertices[i * 3 + 2]);
+            glm::vec3 normal = (i * 3 + 2 < nn)
+                ? glm::vec3(normals[i * 3], normals[i * 3 + 1], normals[i * 3 + 2])
+                : glm::vec3(0.0f, 0.0f, 1.0f);
+            data->packed[i] = packVertex(position, normal, data->quantize);
+        }
 
-        // Unbind VAO
-        glBindVertexArray(0);
+        // Small meshes only need 16-bit indices
+        if (vertexCount <= 65536) {
+            data->shortIndices.assign(data->indices.begin(), data->indices.end());
+        }
 
+        data->memory.set(capacityBytes(data->vertices) + capacityBytes(data->normals) + capacityBytes(data->indices)
+            + capacityBytes(data->packed) + capacityBytes(data->shortIndices), 0);
+        return data;
     }
 
-
     // Render the object
     virtual void display(const glm::mat4 viewMatrix, const glm::mat4 projectionMatrix, const glm::vec3 eyePosition) {
+        PROFILE_ZONE("Object::display");
+        if (VAO == 0) {
+            return; // Headless or failed to load
+        }
         glUseProgram(program);
 
         // Set shader uniforms
@@ -194,36 +329,15 @@ public:
         GLint colorLoc = glGetUniformLocation(program, "objectColor");
         glUniform3fv(colorLoc, 1, glm::value_ptr(color)); // Pass the color to the shader
 
+        setQuantizeUniforms(program, quantize);
+
         // Draw the object
         glBindVertexArray(VAO);
-        glDrawElements(GL_TRIANGLES, triangleCount * 3, GL_UNSIGNED_INT, nullptr);
+        glDrawElements(GL_TRIANGLES, triangleCount * 3, indexType, nullptr);
+        telemetryAdd(telemetry().drawCalls, 1);
         glBindVertexArray(0);
     }
 
-    std::vector<glm::vec3> genFFs(float minHeight = 1.0f) {
-        std::vector<glm::vec3> ffs;
-
-        // Loop through all vertices
-        for (int i = 0; i < triangleCount * 3; ++i) {
-            // Fetch the vertex index from the indices array
-            int vertexIndex = indices[i]; // Use indices to reference the correct vertex
-            int baseIndex = vertexIndex * 3; // Each vertex has 3 components (x, y, z)
-
-            // Get the vertex coordinates
-            float x = vertices[baseIndex + 0];
-            float y = vertices[baseIndex + 1];
-            float z = vertices[baseIndex + 2];
-
-            auto point = roundTo3(glm::vec3(x, y, z));
-
-            // Only consider vertices above the minimum height
-            if (y > minHeight && std::find(ffs.begin(), ffs.end(), point) == ffs.end()) {
-                ffs.emplace_back(point); // Add obstacle point
-            }
-        }
-        return ffs;
-    }
-
     BoundBox getBounds(float minHeight = 0.0f){
         float minX = std::numeric_limits<float>::max();
         float maxX = std::numeric_limits<float>::lowest();
@@ -234,13 +348,13 @@ public:
         // Loop through all vertices
         for (int i = 0; i < triangleCount * 3; ++i) {
             // Fetch the vertex index from the indices array
-            int vertexIndex = indices[i]; // Use indices to reference the correct vertex
+            int vertexIndex = mesh->indices[i]; // Use indices to reference the correct vertex
             int baseIndex = vertexIndex * 3; // Each vertex has 3 components (x, y, z)
 
             // Get the vertex coordinates
-            float x = vertices[baseIndex + 0];
-            float y = vertices[baseIndex + 1];
-            float z = vertices[baseIndex + 2];
+            float x = mesh->vertices[baseIndex + 0];
+            float y = mesh->vertices[baseIndex + 1];
+            float z = mesh->vertices[baseIndex + 2];
 
             if (x < minX) minX = x;
             if (x > maxX) maxX = x;
@@ -259,12 +373,4 @@ public:
             << vec.z << ")" << std::endl;
     }
 
-    glm::vec3 roundTo3(const glm::vec3& point) {
-        return glm::vec3(
-            std::round(point.x * 1000.0f) / 1000.0f,
-            std::round(point.y * 1000.0f) / 1000.0f,
-            std::round(point.z * 1000.0f) / 1000.0f
-        );
-    }
-
 };
@@ -0,0 +1,361 @@
+#pragma once
+
+// Scoped CPU zones and GL_TIME_ELAPSED GPU zones, exported as Chrome trace JSON
+// (load in chrome://tracing or Perfetto) plus per-zone p50/p99 histograms.
+//
+// Everything compiles to nothing unless ENABLE_PROFILER is defined
+// (build with /p:EnableProfiler=true).
+//
+//   PROFILE_ZONE("Member::move");   // CPU time until the end of the scope
+//   GPU_ZONE("bees");               // GPU time of the GL commands in the scope
+//   PROFILE_FRAME();                // Once per frame, on the GL thread
+//   PROFILE_EXPORT("profile.json"); // Write the trace and print the histograms
+
+#ifdef ENABLE_PROFILER
+
+#include <gl/glew.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// One completed zone
+struct ProfileEvent {
+    const char* name;   // Zone name (string literal)
+    uint64_t startNs;   // Start time since the profiler epoch
+    uint64_t durationNs; // Duration
+};
+
+// Single-producer/single-consumer ring owned by one thread. The owning thread
+// pushes without locks; the collector drains it from the GL thread.
+class ProfileRing {
+private:
+    static const uint32_t capacity = 1 << 14; // Power of two
+    ProfileEvent events[capacity];
+    std::atomic<uint32_t> head; // Next slot to write (producer)
+    std::atomic<uint32_t> tail; // Next slot to read (consumer)
+
+public:
+    uint32_t threadId;             // Small id used as the trace "tid"
+    std::atomic<uint32_t> dropped; // Events lost because the ring was full
+
+    explicit ProfileRing(uint32_t id) : head(0), tail(0), threadId(id), dropped(0) {}
+
+    void push(const ProfileEvent& e) {
+        uint32_t h = head.load(std::memory_order_relaxed);
+        if (h - tail.load(std::memory_order_acquire) >= capacity) {
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        events[h & (capacity - 1)] = e;
+        head.store(h + 1, std::memory_order_release);
+    }
+
+    template <typename F>
+    void drain(F&& fn) {
+        uint32_t t = tail.load(std::memory_order_relaxed);
+        uint32_t h = head.load(std::memory_order_acquire);
+        for (; t != h; t++) {
+            fn(events[t & (capacity - 1)]);
+        }
+        tail.store(t, std::memory_order_release);
+    }
+};
+
+// Log-linear histogram of durations (8 sub-buckets per power of two, ~9% error)
+class ProfileHistogram {
+private:
+    static const int subBuckets = 8;
+    static const int bucketCount = 64 * subBuckets;
+    uint64_t counts[bucketCount];
+
+    static int bucketOf(uint64_t ns) {
+        if (ns < subBuckets) return (int)ns;
+        int exp = 63;
+        while (!(ns >> exp)) exp--;
+        int sub = (int)((ns >> (exp - 3)) & (subBuckets - 1));
+        return (exp - 2) * subBuckets + sub;
+    }
+
+    static uint64_t valueOf(int bucket) {
+        if (bucket < subBuckets) return bucket;
+        int exp = bucket / subBuckets + 2;
+        int sub = bucket % subBuckets;
+        return ((uint64_t)(subBuckets + sub) << (exp - 3));
+    }
+
+public:
+    uint64_t total;   // Number of samples
+    uint64_t sumNs;   // Sum of all samples
+    uint64_t maxNs;   // Largest sample
+
+    ProfileHistogram() : total(0), sumNs(0), maxNs(0) {
+        std::fill(counts, counts + bucketCount, 0);
+    }
+
+    void add(uint64_t ns) {
+        counts[bucketOf(ns)]++;
+        total++;
+        sumNs += ns;
+        if (ns > maxNs) maxNs = ns;
+    }
+
+    // Approximate value at quantile q in [0, 1]
+    uint64_t percentile(double q) const {
+        if (total == 0) return 0;
+        uint64_t rank = (uint64_t)(q * (total - 1)) + 1;
+        uint64_t seen = 0;
+        for (int b = 0; b < bucketCount; b++) {
+            seen += counts[b];
+            if (seen >= rank) return std::min(valueOf(b), maxNs);
+        }
+        return maxNs;
+    }
+};
+
+// GL_TIME_ELAPSED queries, read back a few frames later so the CPU never stalls
+class GpuTimerPool {
+private:
+    struct Pending {
+        GLuint query;
+        const char* name;
+        uint64_t startNs; // CPU time at glBeginQuery, used to place the event in the trace
+    };
+
+    std::vector<GLuint> freeQueries;
+    std::vector<Pending> pending;
+    bool active;
+
+public:
+    GpuTimerPool() : active(false) {}
+
+    // GL_TIME_ELAPSED queries cannot nest; nested GPU zones are ignored
+    GLuint begin() {
+        if (active) return 0;
+        GLuint q;
+        if (freeQueries.empty()) {
+            glGenQueries(1, &q);
+        }
+        else {
+            q = freeQueries.back();
+            freeQueries.pop_back();
+        }
+        glBeginQuery(GL_TIME_ELAPSED, q);
+        active = true;
+        return q;
+    }
+
+    void end(GLuint q, const char* name, uint64_t startNs) {
+        if (q == 0) return;
+        glEndQuery(GL_TIME_ELAPSED);
+        active = false;
+        pending.push_back({ q, name, startNs });
+    }
+
+    // Hand finished queries to fn(name, startNs, durationNs)
+    template <typename F>
+    void collect(F&& fn) {
+        size_t kept = 0;
+        for (size_t i = 0; i < pending.size(); i++) {
+            GLint available = 0;
+            glGetQueryObjectiv(pending[i].query, GL_QUERY_RESULT_AVAILABLE, &available);
+            if (available) {
+                GLuint64 ns = 0;
+                glGetQueryObjectui64v(pending[i].query, GL_QUERY_RESULT, &ns);
+                fn(pending[i].name, pending[i].startNs, (uint64_t)ns);
+                freeQueries.push_back(pending[i].query);
+            }
+            else {
+                pending[kept++] = pending[i];
+            }
+        }
+        pending.resize(kept);
+    }
+};
+
+class Profiler {
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    struct TraceEvent {
+        const char* name;
+        uint64_t startNs;
+        uint64_t durationNs;
+        uint32_t threadId;
+    };
+
+    static const size_t maxTraceEvents = 1 << 20; // Oldest events are dropped beyond this
+
+    Clock::time_point epoch;
+    std::mutex ringMutex;                         // Guards ring registration only
+    std::vector<std::unique_ptr<ProfileRing>> rings;
+    std::vector<TraceEvent> trace;                // Collected events for export
+    size_t traceStart;                            // Oldest event once the trace has wrapped
+    std::map<std::string, ProfileHistogram> cpuZones;
+    std::map<std::string, ProfileHistogram> gpuZones;
+    GpuTimerPool gpuTimers;
+
+    Profiler() : epoch(Clock::now()), traceStart(0) {}
+
+    void record(const char* name, uint64_t startNs, uint64_t durationNs, uint32_t threadId) {
+        TraceEvent e = { name, startNs, durationNs, threadId };
+        if (trace.size() < maxTraceEvents) {
+            trace.push_back(e);
+        }
+        else {
+            trace[traceStart] = e;
+            traceStart = (traceStart + 1) % maxTraceEvents;
+        }
+    }
+
+    static void printZones(const char* label, const std::map<std::string, ProfileHistogram>& zones) {
+        std::cout << label << std::endl;
+        std::cout << "  " << std::left << std::setw(28) << "zone" << std::right
+            << std::setw(10) << "count" << std::setw(12) << "mean us"
+            << std::setw(12) << "p50 us" << std::setw(12) << "p99 us" << std::setw(12) << "max us" << std::endl;
+        for (const auto& z : zones) {
+            const ProfileHistogram& h = z.second;
+            std::cout << "  " << std::left << std::setw(28) << z.first << std::right
+                << std::setw(10) << h.total
+                << std::setw(12) << (h.total ? h.sumNs / h.total / 1000.0 : 0.0)
+                << std::setw(12) << h.percentile(0.50) / 1000.0
+                << std::setw(12) << h.percentile(0.99) / 1000.0
+                << std::setw(12) << h.maxNs / 1000.0 << std::endl;
+        }
+    }
+
+public:
+    static Profiler& instance() {
+        static Profiler profiler;
+        return profiler;
+    }
+
+    uint64_t nowNs() const {
+        return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - epoch).count();
+    }
+
+    // Ring for the calling thread, registered on first use
+    ProfileRing& threadRing() {
+        thread_local ProfileRing* ring = nullptr;
+        if (ring == nullptr) {
+            std::lock_guard<std::mutex> lock(ringMutex);
+            rings.emplace_back(new ProfileRing((uint32_t)rings.size() + 1));
+            ring = rings.back().get();
+        }
+        return *ring;
+    }
+
+    GpuTimerPool& gpu() {
+        return gpuTimers;
+    }
+
+    // Drain every thread ring and finished GPU query (GL thread, once per frame)
+    void collect() {
+        std::lock_guard<std::mutex> lock(ringMutex);
+        for (auto& ring : rings) {
+            uint32_t tid = ring->threadId;
+            ring->drain([this, tid](const ProfileEvent& e) {
+                cpuZones[e.name].add(e.durationNs);
+                record(e.name, e.startNs, e.durationNs, tid);
+            });
+        }
+        gpuTimers.collect([this](const char* name, uint64_t startNs, uint64_t ns) {
+            gpuZones[name].add(ns);
+            record(name, startNs, ns, 0); // tid 0 is the GPU track
+        });
+    }
+
+    // Write Chrome trace JSON and print the zone histograms
+    void exportTrace(const char* path) {
+        collect();
+
+        FILE* fid = fopen(path, "w");
+        if (fid == NULL) {
+            std::cerr << "can't open profile output: " << path << std::endl;
+        }
+        else {
+            fprintf(fid, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+            fprintf(fid, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"GPU\"}}");
+            for (size_t i = 0; i < trace.size(); i++) {
+                const TraceEvent& e = trace[(traceStart + i) % trace.size()];
+                fprintf(fid, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+                    e.name, e.threadId, e.startNs / 1000.0, e.durationNs / 1000.0);
+            }
+            fprintf(fid, "\n]}\n");
+            fclose(fid);
+        }
+
+        uint32_t dropped = 0;
+        {
+            std::lock_guard<std::mutex> lock(ringMutex);
+            for (auto& ring : rings) dropped += ring->dropped.load(std::memory_order_relaxed);
+        }
+
+        std::ios::fmtflags flags = std::cout.flags();
+        std::streamsize precision = std::cout.precision();
+        std::cout << std::fixed << std::setprecision(1);
+        printZones("CPU zones:", cpuZones);
+        printZones("GPU zones:", gpuZones);
+        if (dropped > 0) {
+            std::cout << "  (" << dropped << " events dropped, ring full)" << std::endl;
+        }
+        std::cout.flags(flags);
+        std::cout.precision(precision);
+    }
+};
+
+// RAII CPU zone
+class ProfileZone {
+private:
+    const char* name;
+    uint64_t start;
+
+public:
+    explicit ProfileZone(const char* zoneName) : name(zoneName), start(Profiler::instance().nowNs()) {}
+
+    ~ProfileZone() {
+        Profiler& p = Profiler::instance();
+        uint64_t end = p.nowNs();
+        p.threadRing().push({ name, start, end - start });
+    }
+};
+
+// RAII GPU zone (GL thread only)
+class GpuZone {
+private:
+    const char* name;
+    uint64_t start;
+    GLuint query;
+
+public:
+    explicit GpuZone(const char* zoneName)
+        : name(zoneName), start(Profiler::instance().nowNs()), query(Profiler::instance().gpu().begin()) {}
+
+    ~GpuZone() {
+        Profiler::instance().gpu().end(query, name, start);
+    }
+};
+
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+#define PROFILE_ZONE(name) ProfileZone PROFILE_CONCAT(profileZone_, __LINE__)(name)
+#define GPU_ZONE(name) GpuZone PROFILE_CONCAT(gpuZone_, __LINE__)(name)
+#define PROFILE_FRAME() Profiler::instance().collect()
+#define PROFILE_EXPORT(path) Profiler::instance().exportTrace(path)
+
+#else
+
+#define PROFILE_ZONE(name) ((void)0)
+#define GPU_ZONE(name) ((void)0)
+#define PROFILE_FRAME() ((void)0)
+#define PROFILE_EXPORT(path) ((void)0)
+
+#endif
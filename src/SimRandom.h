@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdlib>
+#define GLM_FORCE_RADIANS
+#include <glm/glm.hpp>
+
+// Counter-based random generator (splitmix64). The whole state is one 64-bit
+// counter, so a checkpoint restores the exact random sequence, and every bee
+// can own an independent stream without sharing std::rand.
+struct SimRandom {
+    uint64_t state; // Advances by a fixed odd constant per draw
+
+    explicit SimRandom(uint64_t seed = 0) : state(seed) {}
+
+    // Seed from std::rand, for callers that do not care about reproducibility
+    static uint64_t randomSeed() {
+        uint64_t seed = 0;
+        for (int i = 0; i < 4; i++) {
+            seed = (seed << 16) ^ (uint64_t)(std::rand() & 0xFFFF);
+        }
+        return seed;
+    }
+
+    uint64_t next() {
+        uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        return z ^ (z >> 31);
+    }
+
+    // Uniform float in [lo, hi)
+    float uniform(float lo, float hi) {
+        return lo + (hi - lo) * ((next() >> 40) * (1.0f / 16777216.0f));
+    }
+
+    // Uniform point in the box [lo, hi), like glm::linearRand
+    glm::vec3 linearRand(const glm::vec3& lo, const glm::vec3& hi) {
+        float x = uniform(lo.x, hi.x);
+        float y = uniform(lo.y, hi.y);
+        float z = uniform(lo.z, hi.z);
+        return glm::vec3(x, y, z);
+    }
+};
\ No newline at end of file
@@ -0,0 +1,547 @@
+#pragma once
+
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <vector>
+#include "Member.h"
+#include "EcoObj.h"
+#include "LandMass.h"
+#include "Profiler.h"
+#include "Telemetry.h"
+#include "SimRandom.h"
+#include "TimerWheel.h"
+#include "FrameArena.h"
+#include "SwarmIndex.h"
+#include "FlowField.h"
+#include "ClearanceField.h"
+#include "NectarStore.h"
+
+// Colony parameters. The defaults are the values the simulation has always used.
+struct SimulationConfig {
+    int initialBees = 25;           // Bees created with the hive
+    int maxBees = 200;              // Spawning stops at this swarm size
+    int flowerCount = 50;           // Flowers alive at any time
+    int maxPollen = 500;            // Pollen needed for a full-size hive
+    double beeSpawnSeconds = 60.0;  // Base spawn interval, divided by sqrt(pollen + 1)
+    double flowerSeconds = 10.0;    // Interval between flower replacements
+    uint64_t seed = 0;              // Colony random seed, 0 picks one from std::rand
+    float cohesionTheta = 0.5f;     // Barnes-Hut opening angle for swarm cohesion, 0 for exact averages
+    int lodSlices = 4;              // Bees in open transit steer once per this many ticks, 1 for every tick
+    float lodViewRadius = 60.0f;    // Bees this close to the viewpoint steer every tick
+    int lodMaxSteers = 0;           // Full steering updates allowed per tick, 0 for no cap
+    float nectarLoads = 3.0f;       // Loads of nectar a full flower holds, 0 for no limit
+    float nectarRefillSeconds = 5.0f; // Time a flower takes to regain one load
+};
+
+// Terrain as saved in checkpoints. Never changes after generation, so every
+// capture of a simulation shares the same copy.
+struct TerrainState {
+    int n;                                   // Terrain exponent (grid side 2^n + 1)
+    std::vector<std::vector<float>> heights; // Height grid, indexed [x][z]
+};
+
+// Complete simulation state, detached from the live objects. Captured on the
+// main thread (a plain copy of the colony) and safe to read on any thread.
+struct SimulationState {
+    uint64_t tick;                              // Ticks run so far
+    double clock;                               // Simulation clock at the last tick (seconds)
+    double beeTimer;                            // Time of the last bee spawn
+    double flowerTimer;                         // Time of the last flower replacement
+    int plnCount;                               // Pollen counted towards hive growth
+    uint64_t rng;                               // Colony random stream position
+    SimulationConfig config;                    // Colony parameters
+    std::shared_ptr<const TerrainState> terrain; // Shared, immutable
+    std::vector<MemberState> bees;              // Every bee, in swarm order
+    std::vector<glm::vec3> flowers;             // Flower positions, oldest first
+    std::vector<float> nectar;                  // Loads left in each flower, parallel to flowers
+};
+
+// The simulation state and tick: bee spawning, flower lifecycle, bee movement,
+// pollen accounting and hive growth. No GL calls happen here apart from the
+// mesh uploads done by new Objects, so it runs headless as well as in main.
+class Simulation {
+public:
+    LandMass& land;                              // Terrain the colony lives on
+    BoundBox bounds;                             // Flight volume
+    glm::vec3 hiveLoc;                           // Hive position, bees spawn here
+    GLuint program;                              // Shader program for new objects
+    SimulationConfig config;                     // Colony parameters
+    std::vector<std::shared_ptr<Member>> swarm;  // Bees
+    std::vector<std::shared_ptr<EcoObj>> flowers; // Flowers
+    std::vector<glm::vec3> flowerPts;            // Flower positions, parallel to flowers
+    std::unique_ptr<EcoObj> hive;                // The hive
+    int plnCount;                                // Pollen delivered to the hive
+    double beeTimer;                             // Time of the last bee spawn (seconds)
+    double flowerTimer;                          // Time of the last flower replacement (seconds)
+    double clock;                                // Simulation clock at the last tick (seconds)
+    uint64_t tickCount;                          // Ticks run so far
+    SimRandom rng;                               // Flower placement and bee seeds
+    MortonGrid grid;                             // Morton code quantization of the flight volume
+    std::ostream* log;                           // Colony events, null for silence (telemetry counts them too)
+
+    Simulation(LandMass& land, GLuint shaderProgram, const SimulationConfig& config = SimulationConfig(), std::ostream* log = &std::cout)
+        : land(land), bounds(land.getBounds()), hiveLoc(0.0f), program(shaderProgram), config(config),
+        plnCount(0), beeTimer(0.0), flowerTimer(0.0), clock(0.0), tickCount(0),
+        rng(config.seed != 0 ? config.seed : SimRandom::randomSeed()), grid(bounds.min, bounds.max), log(log),
+        flowField(bounds, flowCell, 2.0f * Member::senseRadius()),
+        clearanceField(land, bounds, std::max(1.0f, (land.getGridSize() - 1) / 128.0f)),
+        nectar(config.nectarLoads, config.nectarRefillSeconds) {
+        hiveLoc.y = land.getHeight(hiveLoc.x, hiveLoc.z) + 2;
+        flowField.setHome(hiveLoc, land, flowClimbCost);
+        hive.reset(new EcoObj("hive", program, glm::vec3(1.0f, 0.627f, 0.196f), hiveLoc, glm::vec3(0, 0, 1)));
+        hiveBVH = Object::loadBVH("hive");
+        hiveMesh = PlacedMesh(hiveBVH.get(), hive->modelMatrix);
+
+        // Create initial swarm of bees
+        swarm.reserve(config.maxBees > config.initialBees ? config.maxBees : config.initialBees);
+        mortonOrder.reserve(swarm.capacity());
+        for (int i = 0; i < config.initialBees; ++i) {
+            spawnBee();
+        }
+
+        // Generate initial flowers
+        for (int i = 0; i < config.flowerCount; ++i) {
+            glm::vec3 fp = randomFlowerPoint();
+            flowerPts.push_back(fp);
+            flowers.emplace_back(makeFlower(fp));
+            flowField.addFlower(fp);
+            nectar.bloom();
+        }
+        updateHive();
+        scheduleEvents();
+        publishGauges(0);
+    }
+
+    // Advance one tick. `now` is the simulation clock in seconds and drives the
+    // spawn/lifecycle events, `delta` is the movement step of every bee. Nothing
+    // here reads the wall clock, so ticks can run as fast as the CPU allows.
+    void tick(double now, float delta) {
+        auto tickStart = std::chrono::steady_clock::now();
+        nectar.refill((float)(now - clock));
+        clock = now;
+        tickCount++;
+
+        // Spawn bees and cycle flowers whose events came due
+        events.advance(now, [this](const TimerWheel::Fired& e) { fire(e.kind); });
+
+        // Move the swarm against a snapshot of this tick's positions, taken
+        // into the tick arena so a steady-state tick never touches the heap.
+        // Bees move in Morton order so consecutive neighbor queries share cells.
+        SwarmIndex team;
+        {
+            PROFILE_ZONE("swarm index");
+            team.build(swarm, grid, mortonOrder, arena);
+            team.theta = config.cohesionTheta;
+        }
+        const uint8_t* plan = planSteering(team, delta);
+        const uint8_t* sight = senseFlowers(team, plan);
+
+        // Bees that reach a flower claim a load of its nectar as they move, and
+        // the claims are settled once every bee has moved (see NectarStore)
+        size_t count = team.size();
+        int32_t* reached = arena.alloc<int32_t>(count); // Flower each bee claimed from, -1 for none
+        for (size_t k = 0; k < count; k++) {
+            uint32_t id = team.ids[k];
+            Member& bee = *swarm[id];
+            reached[k] = -1;
+            if (plan[k] != lodCoast) {
+                if (bee.move(delta, team, flowField, sight[k] != 0, clearanceField, hiveMesh, bounds)) {
+                    reached[k] = flowField.nearestFlower(team.pos[k]).index;
+                    if (reached[k] >= 0) nectar.reserve(reached[k], claimPriority(id));
+                }
+            }
+            else {
+                bee.coast(delta); // Keep flying on the last steering
+            }
+        }
+
+        int collected = 0;
+        for (size_t k = 0; k < count; k++) {
+            uint32_t id = team.ids[k];
+            Member& bee = *swarm[id];
+            bee.settle(team.pos[k], land); // Sweep the step from the snapshot position
+            if (reached[k] >= 0 && nectar.collect(reached[k], claimPriority(id))) {
+                bee.collect();
+                collected++;
+            }
+            bee.update(); // Update bee state
+        }
+        long long contended = nectar.endTick();
+        contendedClaims += contended;
+
+        int returning = 0;
+        int delivered = 0;
+        for (const auto& bee : swarm) {
+            int pollen = bee->getPollen();
+            delivered += pollen;
+            returning += bee->isReturningHome() ? 1 : 0;
+            if (plnCount < config.maxPollen) {
+                plnCount += pollen;
+                if (plnCount == config.maxPollen && log != nullptr) {
+                    *log << "Max Hive!!!\n" << (long long)now << "\n";
+                }
+            }
+        }
+
+        updateHive();
+        if (plnCount != spawnPollen) {
+            scheduleSpawn(); // More pollen, shorter spawn interval
+        }
+        arena.reset(); // Tick-scoped buffers are dead from here on
+
+        TelemetryCounters& stats = telemetry();
+        telemetryAdd(stats.pollenDelivered, delivered);
+        telemetryAdd(stats.nectarCollected, collected);
+        telemetryAdd(stats.nectarContended, contended);
+        telemetryAdd(stats.ticks, 1);
+        publishGauges(returning);
+        stats.tickUs.record((uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - tickStart).count());
+    }
+
+    // Copy the state for a checkpoint. Cheap: the colony is a few hundred
+    // plain structs and the terrain is shared after the first capture.
+    SimulationState capture() {
+        if (!terrainState) {
+            TerrainState* terrain = new TerrainState();
+            terrain->n = land.getExponent();
+            terrain->heights = land.getHeightGrid();
+            terrainState.reset(terrain);
+        }
+
+        SimulationState state;
+        state.tick = tickCount;
+        state.clock = clock;
+        state.beeTimer = beeTimer;
+        state.flowerTimer = flowerTimer;
+        state.plnCount = plnCount;
+        state.rng = rng.state;
+        state.config = config;
+        state.terrain = terrainState;
+        state.bees.reserve(swarm.size());
+        for (const auto& bee : swarm) {
+            state.bees.push_back(bee->getState());
+        }
+        state.flowers = flowerPts;
+        state.nectar.resize(nectar.size());
+        for (size_t f = 0; f < nectar.size(); f++) {
+            state.nectar[f] = nectar.nectar(f);
+        }
+        return state;
+    }
+
+    // Replace the colony with a captured state. `land` must be the terrain the
+    // state was captured on (see LandMass(int, heights)).
+    void restore(const SimulationState& state) {
+        config = state.config;
+        tickCount = state.tick;
+        clock = state.clock;
+        beeTimer = state.beeTimer;
+        flowerTimer = state.flowerTimer;
+        plnCount = state.plnCount;
+        rng.state = state.rng;
+        terrainState = state.terrain;
+
+        swarm.clear();
+        for (const auto& s : state.bees) {
+            swarm.emplace_back(std::allocate_shared<Member>(TaggedAllocator<Member>(memorySwarm), "bee", program, s.color, s.h, 0));
+            swarm.back()->setState(s);
+        }
+
+        flowers.clear();
+        flowerPts = state.flowers;
+        nectar.setLimits(config.nectarLoads, config.nectarRefillSeconds);
+        nectar.clear();
+        for (size_t f = 0; f < flowerPts.size(); f++) {
+            flowers.emplace_back(makeFlower(flowerPts[f]));
+            nectar.bloom();
+            if (f < state.nectar.size()) nectar.setNectar(f, state.nectar[f]);
+        }
+        flowField.setFlowers(flowerPts);
+
+        updateHive();
+        scheduleEvents(); // Pending events follow from the restored timers
+        publishGauges(0);
+    }
+
+    // Replay: show a recorded hive size and flower set instead of simulating.
+    // The bees themselves are drawn straight from the recording.
+    void showReplay(uint64_t tick, int pollen, const std::vector<glm::vec3>& flowerSet) {
+        tickCount = tick;
+        plnCount = pollen;
+        if (flowerSet != flowerPts) {
+            flowerPts = flowerSet;
+            flowers.clear();
+            nectar.clear();
+            for (const auto& fp : flowerPts) {
+                flowers.emplace_back(makeFlower(fp));
+                nectar.bloom();
+            }
+            flowField.setFlowers(flowerPts);
+        }
+        updateHive();
+    }
+
+    // Camera position for the behavior LOD: bees near it steer every tick. Not
+    // part of the saved state, so a viewed colony only replays exactly from a
+    // checkpoint under the same camera path.
+    void setViewpoint(const glm::vec3& eye) {
+        viewpoint = eye;
+        hasViewpoint = true;
+    }
+
+    // Nectar claims this colony has lost to another bee at the same flower
+    long long nectarContended() const {
+        return contendedClaims;
+    }
+
+    // Most claims any living flower of this colony has turned away
+    int busiestFlower() const {
+        return (int)nectar.busiest();
+    }
+
+private:
+    // Scheduled colony events, in firing order for events due at the same time
+    enum EventKind {
+        spawnEvent = 0,  // A bee hatches at the hive
+        witherEvent = 1, // The oldest flower dies
+        bloomEvent = 2   // A new flower opens somewhere random
+    };
+
+    // Behavior LOD buckets, in steering priority order
+    enum LodBucket : uint8_t {
+        lodNear = 0,    // Close to the viewpoint
+        lodBusy = 1,    // Within a step of a flower, the hive or the bounds
+        lodDue = 2,     // In open transit, steering in this tick's slice
+        lodCoast = 3    // In open transit between slices, or over the steering cap
+    };
+
+    static constexpr float flowCell = 2.0f;      // Side of a flow field cell
+    static constexpr float flowClimbCost = 4.0f; // Homing cost per unit of terrain climbed, on top of the distance
+
+    std::shared_ptr<const TerrainState> terrainState; // Terrain copy shared by every capture
+    TimerWheel events;                                // Pending colony events on the simulation clock
+    FrameArena arena;                                 // Scratch memory for one tick, reset at its end
+    MortonOrder mortonOrder;                          // Swarm indices in Morton order, re-sorted every tick
+    FlowField flowField;                              // Nearest flowers and the way home, by terrain cell
+    ClearanceField clearanceField;                    // Distance to the ground, for avoidance
+    NectarStore nectar;                               // Nectar left in each flower and the claims on it, parallel to flowerPts
+    std::shared_ptr<const MeshBVH> hiveBVH;           // The hive model's triangles, for collision queries
+    PlacedMesh hiveMesh;                              // hiveBVH where the hive stands at its current size
+    glm::vec3 viewpoint = glm::vec3(0.0f);            // Camera position for the behavior LOD
+    bool hasViewpoint = false;                        // No camera (headless): no near bucket
+    TimerWheel::Handle spawnHandle = TimerWheel::none; // Next spawn, rescheduled as pollen arrives
+    int spawnPollen = 0;                              // Pollen count the spawn time was computed from
+    bool spawnCapped = false;                         // A spawn was skipped for the memory budget
+    long long contendedClaims = 0;                    // Nectar claims lost so far, for nectarContended()
+
+    // Priority of bee `id` when it claims nectar this tick, lower first. A
+    // rotation of the swarm index, so ties break the same way however the
+    // claims are made but no bee always loses a contested flower.
+    uint32_t claimPriority(uint32_t id) const {
+        return (uint32_t)((id + tickCount) % swarm.size());
+    }
+
+    // Bucket every entry of `team` for this tick. Near and busy bees steer;
+    // transit bees steer once every lodSlices ticks, staggered by swarm index,
+    // and coast in between. With lodMaxSteers the steering goes to the buckets
+    // in priority order; a bucket that only partly fits rotates its share
+    // round the swarm from tick to tick and the rest coast.
+    const uint8_t* planSteering(const SwarmIndex& team, float delta) {
+        PROFILE_ZONE("behavior LOD");
+        size_t count = team.size();
+        uint8_t* plan = arena.alloc<uint8_t>(count);
+        int sizes[4] = { 0, 0, 0, 0 };
+        uint64_t slices = config.lodSlices > 1 ? (uint64_t)config.lodSlices : 1;
+        float view2 = config.lodViewRadius * config.lodViewRadius;
+        float step = Member::topSpeed() * delta;
+        for (size_t k = 0; k < count; k++) {
+            uint32_t id = team.ids[k];
+            glm::vec3 offset = team.pos[k] - viewpoint;
+            if (hasViewpoint && glm::dot(offset, offset) < view2) {
+                plan[k] = lodNear;
+            }
+            else if (!(swarm[id]->getClearance() > step)) {
+                plan[k] = lodBusy;
+            }
+            else {
+                plan[k] = (id + tickCount) % slices == 0 ? lodDue : lodCoast;
+            }
+            sizes[plan[k]]++;
+        }
+
+        int budget = config.lodMaxSteers > 0 ? config.lodMaxSteers : (int)count;
+        int allowed[lodCoast];
+        int capped = 0;
+        for (int b = 0; b < lodCoast; b++) {
+            allowed[b] = sizes[b] < budget ? sizes[b] : budget;
+            budget -= allowed[b];
+            capped += sizes[b] - allowed[b];
+        }
+        if (capped > 0) {
+            size_t start = (size_t)(tickCount % count);
+            for (size_t j = 0; j < count; j++) {
+                uint8_t& b = plan[(start + j) % count];
+                if (b != lodCoast) {
+                    if (allowed[b] > 0) allowed[b]--;
+                    else b = lodCoast;
+                }
+            }
+        }
+
+        TelemetryCounters& stats = telemetry();
+        telemetrySet(stats.lodNear, sizes[lodNear]);
+        telemetrySet(stats.lodBusy, sizes[lodBusy]);
+        telemetrySet(stats.lodTransit, sizes[lodDue] + sizes[lodCoast]);
+        telemetryAdd(stats.lodSteers, (long long)count - sizes[lodCoast] - capped);
+        telemetryAdd(stats.lodCapped, capped);
+        return plan;
+    }
+
+    // Whether each bee of `team` that steers this tick can see the flower the
+    // flower field offers it, 1 for the rest. Only the flowers within sensing
+    // range need a look; their sight lines go to the terrain in one batch.
+    const uint8_t* senseFlowers(const SwarmIndex& team, const uint8_t* plan) {
+        PROFILE_ZONE("flower sight");
+        size_t count = team.size();
+        uint8_t* sight = arena.alloc<uint8_t>(count);
+        glm::vec3* from = arena.alloc<glm::vec3>(count);
+        glm::vec3* to = arena.alloc<glm::vec3>(count);
+        uint32_t* looking = arena.alloc<uint32_t>(count); // Team entry of each sight line
+        size_t lines = 0;
+        for (size_t k = 0; k < count; k++) {
+            sight[k] = 1;
+            if (plan[k] == lodCoast || swarm[team.ids[k]]->isReturningHome()) continue;
+            FlowField::NearestFlower flower = flowField.nearestFlower(team.pos[k]);
+            if (flower.found && glm::length(flower.position - team.pos[k]) < Member::senseRadius()) {
+                from[lines] = team.pos[k];
+                to[lines] = flower.position;
+                looking[lines++] = (uint32_t)k;
+            }
+        }
+        uint8_t* visible = arena.alloc<uint8_t>(lines);
+        land.lineOfSight(Span<glm::vec3>(from, lines), Span<glm::vec3>(to, lines), visible);
+        for (size_t l = 0; l < lines; l++) sight[looking[l]] = visible[l];
+        return sight;
+    }
+
+    // Rebuild the pending events from the timers. Only the timers are saved in
+    // checkpoints, so a restored colony gets exactly the events it had.
+    void scheduleEvents() {
+        events.clear(clock);
+        spawnHandle = TimerWheel::none;
+        scheduleSpawn();
+        events.schedule(flowerTimer + config.flowerSeconds, witherEvent);
+        events.schedule(flowerTimer + config.flowerSeconds, bloomEvent);
+    }
+
+    // Next spawn: beeSpawnSeconds / sqrt(pollen + 1) after the last one
+    void scheduleSpawn() {
+        events.cancel(spawnHandle);
+        spawnPollen = plnCount;
+        if ((int)swarm.size() < config.maxBees) {
+            spawnHandle = events.schedule(beeTimer + config.beeSpawnSeconds / std::sqrt(plnCount + 1), spawnEvent);
+        }
+    }
+
+    void fire(int kind) {
+        TelemetryCounters& stats = telemetry();
+        switch (kind) {
+        case spawnEvent: {
+            PROFILE_ZONE("bee spawn");
+            spawnHandle = TimerWheel::none;
+            if (memoryOverBudget(memorySwarm)) {
+                // Past the memory budget: skip this hatch instead of growing into swap
+                beeTimer = clock;
+                telemetryAdd(stats.spawnsCapped, 1);
+                if (!spawnCapped && log != nullptr) {
+                    *log << "Memory budget reached, no more bees will hatch.\n";
+                }
+                spawnCapped = true;
+                scheduleSpawn();
+                break;
+            }
+            spawnBee();
+            beeTimer = clock;
+            telemetryAdd(stats.beesBorn, 1);
+            if (log != nullptr) {
+                if ((int)swarm.size() == config.maxBees) {
+                    *log << "A New Bee was Born!! Max Beez!!!\n" << (long long)clock << "\n";
+                }
+                else {
+                    *log << "A New Bee was Born!!\n";
+                }
+            }
+            scheduleSpawn();
+            break;
+        }
+        case witherEvent: {
+            PROFILE_ZONE("flower lifecycle");
+            if (!flowerPts.empty()) {
+                glm::vec3 withered = flowerPts.front();
+                flowerPts.erase(flowerPts.begin()); // Remove the first flower
+                flowers.erase(flowers.begin());
+                flowField.removeFlower(withered, flowerPts);
+                nectar.wither();
+            }
+            events.schedule(clock + config.flowerSeconds, witherEvent);
+            break;
+        }
+        case bloomEvent: {
+            PROFILE_ZONE("flower lifecycle");
+            glm::vec3 newFlower = randomFlowerPoint();
+            flowerPts.push_back(newFlower); // Add new flower point
+
+            flowers.emplace_back(makeFlower(newFlower));
+            flowField.addFlower(newFlower);
+            nectar.bloom();
+            flowerTimer = clock;
+            telemetryAdd(stats.flowersReplaced, 1);
+            if (log != nullptr) {
+                *log << "As one blossom withers, another blooms.\n";
+            }
+            events.schedule(clock + config.flowerSeconds, bloomEvent);
+            break;
+        }
+        }
+    }
+
+    // Bees and flowers are charged to their own memory accounts
+    void spawnBee() {
+        swarm.emplace_back(std::allocate_shared<Member>(TaggedAllocator<Member>(memorySwarm), "bee", program, glm::vec3(1.0f, 0.843f, 0.0f), hiveLoc, rng.next()));
+    }
+
+    std::shared_ptr<EcoObj> makeFlower(const glm::vec3& fp) {
+        return std::allocate_shared<EcoObj>(TaggedAllocator<EcoObj>(memoryFlowers), "flower_platform", program, glm::vec3(1.0f, 0.4118f, 0.7059f), fp, glm::vec3(0, 0, 1));
+    }
+
+    // Random point on the terrain, at least 10 units from the hive
+    glm::vec3 randomFlowerPoint() {
+        glm::vec3 fp;
+        do {
+            fp = rng.linearRand(bounds.min + glm::vec3(1.0f), bounds.max - glm::vec3(1.0f));
+        } while (glm::length(fp) < 10.0f); // Re-randomize if within 10 units of the origin
+        fp.y = land.getHeight(fp.x, fp.z) + 0.5f;
+        return fp;
+    }
+
+    // Colony gauges for the telemetry publisher
+    void publishGauges(int returning) {
+        TelemetryCounters& stats = telemetry();
+        telemetrySet(stats.beesAlive, swarm.size());
+        telemetrySet(stats.beesReturning, returning);
+        telemetrySet(stats.flowers, flowers.size());
+        telemetrySet(stats.hivePollen, plnCount);
+        telemetrySet(stats.busiestFlower, nectar.busiest());
+    }
+
+    // The hive grows with the pollen delivered
+    void updateHive() {
+        hive->setSize(2.5 + (plnCount * 0.01)); // Update hive size
+        hive->turnUpsideDown(); // Animate hive
+        hiveMesh.place(hive->modelMatrix);
+    }
+};
\ No newline at end of file
@@ -0,0 +1,139 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <future>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Small startup task graph. CPU work (terrain generation, mesh decode, shader
+// source reads) runs on worker threads while the main thread creates the window.
+// Each task may queue a follow-up that touches GL; those are drained on the main
+// thread as results arrive. Every phase is timed for the startup report.
+class StartupPipeline {
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    struct Phase {
+        std::string name; // Phase label in the report
+        double startMs;   // Start, relative to pipeline creation
+        double endMs;     // End, relative to pipeline creation
+        bool worker;      // Ran on a worker thread
+    };
+
+    Clock::time_point origin;                   // Time the pipeline was created
+    std::vector<std::future<void>> workers;     // Running worker tasks
+    std::deque<std::function<void()>> uploads;  // Main-thread follow-ups ready to run
+    int pending;                                // Submitted tasks whose follow-up has not run yet
+    std::vector<Phase> phases;                  // Completed phases
+    std::mutex mutex;                           // Guards uploads, pending and phases
+    std::condition_variable ready;              // Signalled when an upload is queued
+
+    double nowMs() const {
+        return std::chrono::duration<double, std::milli>(Clock::now() - origin).count();
+    }
+
+    void record(const std::string& name, double startMs, double endMs, bool worker) {
+        std::lock_guard<std::mutex> lock(mutex);
+        phases.push_back({ name, startMs, endMs, worker });
+    }
+
+public:
+    explicit StartupPipeline(Clock::time_point start = Clock::now())
+        : origin(start), pending(0) {}
+
+    // Wait for stray workers so nothing outlives the pipeline
+    ~StartupPipeline() {
+        for (auto& w : workers) {
+            if (w.valid()) w.wait();
+        }
+    }
+
+    // Run `work` on a worker thread, then `upload` on the main thread during drain()
+    void submit(const std::string& name, std::function<void()> work, std::function<void()> upload = nullptr) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            pending++;
+        }
+        workers.emplace_back(std::async(std::launch::async, [this, name, work, upload]() {
+            double start = nowMs();
+            std::exception_ptr failure;
+            try {
+                work();
+            }
+            catch (...) {
+                failure = std::current_exception(); // Rethrown on the main thread by drain()
+            }
+            record(name, start, nowMs(), true);
+
+            std::lock_guard<std::mutex> lock(mutex);
+            uploads.emplace_back([this, name, upload, failure]() {
+                if (failure) {
+                    std::rethrow_exception(failure);
+                }
+                if (upload) {
+                    double uploadStart = nowMs();
+                    upload();
+                    record(name + " (upload)", uploadStart, nowMs(), false);
+                }
+            });
+            ready.notify_one();
+        }));
+    }
+
+    // Time a phase that runs on the calling (main) thread
+    template <typename F>
+    void run(const std::string& name, F&& fn) {
+        double start = nowMs();
+        fn();
+        record(name, start, nowMs(), false);
+    }
+
+    // Run queued uploads as their tasks finish, until every submitted task is done
+    void drain() {
+        double start = nowMs();
+        std::unique_lock<std::mutex> lock(mutex);
+        while (pending > 0) {
+            ready.wait(lock, [this]() { return !uploads.empty(); });
+            std::function<void()> upload = uploads.front();
+            uploads.pop_front();
+            pending--;
+
+            lock.unlock();
+            upload();
+            lock.lock();
+        }
+        lock.unlock();
+
+        workers.clear();
+        record("drain", start, nowMs(), false);
+    }
+
+    // Milliseconds since the pipeline was created
+    double elapsedMs() const {
+        return nowMs();
+    }
+
+    // Print the wall-clock time of every phase
+    void report() {
+        std::lock_guard<std::mutex> lock(mutex);
+        std::ios::fmtflags flags = std::cout.flags();
+        std::streamsize precision = std::cout.precision();
+        std::cout << "Startup report:" << std::endl;
+        for (const auto& p : phases) {
+            std::cout << "  " << std::left << std::setw(32) << p.name
+                << (p.worker ? " [worker] " : " [main]   ")
+                << std::right << std::fixed << std::setprecision(1)
+                << std::setw(8) << (p.endMs - p.startMs) << " ms"
+                << "  (" << p.startMs << " -> " << p.endMs << ")" << std::endl;
+        }
+        std::cout.flags(flags);
+        std::cout.precision(precision);
+    }
+};
@@ -0,0 +1,353 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+#include "FrameArena.h"
+
+// Interleave the low 21 bits of v with two zero bits between each
+inline uint64_t mortonSpread(uint32_t v) {
+    uint64_t x = v & 0x1FFFFF;
+    x = (x | x << 32) & 0x1F00000000FFFFull;
+    x = (x | x << 16) & 0x1F0000FF0000FFull;
+    x = (x | x << 8) & 0x100F00F00F00F00Full;
+    x = (x | x << 4) & 0x10C30C30C30C30C3ull;
+    x = (x | x << 2) & 0x1249249249249249ull;
+    return x;
+}
+
+// 3D Morton (Z-order) code of integer coordinates below 2^21
+inline uint64_t mortonCode(uint32_t x, uint32_t y, uint32_t z) {
+    return mortonSpread(x) | mortonSpread(y) << 1 | mortonSpread(z) << 2;
+}
+
+// Cube over the flight volume quantized to 2^21 steps per axis. Every aligned
+// cube of 2^k steps covers one contiguous range of Morton codes, so a swarm
+// sorted by code holds each such cell as one run of bees. Positions outside
+// the cube are clamped onto its faces.
+struct MortonGrid {
+    static const int bits = 21;           // Quantization bits per axis
+    static const uint32_t maxStep = (1u << bits) - 1;
+
+    glm::vec3 origin; // Minimum corner of the cube
+    float scale;      // Steps per world unit
+
+    MortonGrid() : origin(0.0f), scale(1.0f) {}
+
+    // Grid over the cube at `min` enclosing `max`
+    MortonGrid(const glm::vec3& min, const glm::vec3& max) : origin(min) {
+        float side = std::max(max.x - min.x, std::max(max.y - min.y, max.z - min.z));
+        scale = side > 0.0f ? (float)(1u << bits) / side : 1.0f;
+    }
+
+    uint32_t step(float v, float o) const {
+        float s = (v - o) * scale;
+        if (!(s > 0.0f)) return 0; // Also NaN
+        return s >= (float)maxStep ? maxStep : (uint32_t)s;
+    }
+
+    uint64_t code(const glm::vec3& p) const {
+        return mortonCode(step(p.x, origin.x), step(p.y, origin.y), step(p.z, origin.z));
+    }
+};
+
+// Permutation of the swarm into Morton order, kept between ticks. Bees move a
+// short way per tick, so last tick's order is nearly sorted and an
+// insertion sort finishes it in about one pass. After a restore, or whenever
+// that would take too many moves, it radix sorts instead. Ties go to the lower
+// swarm index, so the result depends only on the codes, never on earlier ticks.
+class MortonOrder {
+private:
+    std::vector<uint32_t> order; // Swarm indices, in Morton order as of the last sort
+
+    static bool before(const uint64_t* keys, uint32_t a, uint32_t b) {
+        return keys[a] != keys[b] ? keys[a] < keys[b] : a < b;
+    }
+
+    // Finish sorting `order` from where it is; false if that takes too many moves
+    bool insertionSort(const uint64_t* keys) {
+        size_t budget = order.size() * 4 + 64;
+        for (size_t i = 1; i < order.size(); i++) {
+            uint32_t id = order[i];
+            size_t j = i;
+            while (j > 0 && before(keys, id, order[j - 1])) {
+                order[j] = order[j - 1];
+                j--;
+                if (--budget == 0) {
+                    order[j] = id;
+                    return false;
+                }
+            }
+            order[j] = id;
+        }
+        return true;
+    }
+
+    // LSD radix sort of the swarm indices, 8 bits per pass. Starts from
+    // ascending indices and every pass is stable, which settles the ties.
+    void radixSort(const uint64_t* keys, FrameArena& arena) {
+        size_t count = order.size();
+        uint32_t* buffer = arena.alloc<uint32_t>(count);
+        uint32_t* src = order.data();
+        uint32_t* dst = buffer;
+        for (size_t i = 0; i < count; i++) src[i] = (uint32_t)i;
+        for (int shift = 0; shift < 64; shift += 8) {
+            size_t counts[256] = {};
+            for (size_t i = 0; i < count; i++) counts[(keys[src[i]] >> shift) & 0xFF]++;
+            if (counts[(keys[src[0]] >> shift) & 0xFF] == count) continue; // Byte is the same everywhere
+            size_t start = 0;
+            for (auto& c : counts) {
+                size_t n = c;
+                c = start;
+                start += n;
+            }
+            for (size_t i = 0; i < count; i++) dst[counts[(keys[src[i]] >> shift) & 0xFF]++] = src[i];
+            std::swap(src, dst);
+        }
+        if (src != order.data()) std::copy(src, src + count, order.data());
+    }
+
+public:
+    void reserve(size_t count) {
+        order.reserve(count);
+    }
+
+    // Sort bees 0..count-1 by keys[i]. The result stays valid until the next call.
+    Span<uint32_t> sort(const uint64_t* keys, size_t count, FrameArena& arena) {
+        if (order.size() > count) order.clear(); // The swarm was replaced
+        for (size_t i = order.size(); i < count; i++) order.push_back((uint32_t)i); // New bees
+        if (count > 1 && !insertionSort(keys)) {
+            radixSort(keys, arena);
+        }
+        return Span<uint32_t>(order.data(), count);
+    }
+};
+
+// Octree node over a run of the Morton-sorted swarm, with the totals that let
+// a query take the whole run at once
+struct SwarmNode {
+    glm::vec3 min;      // Bounds of the positions below this node
+    glm::vec3 max;
+    glm::vec3 posSum;   // Sum of the positions
+    glm::vec3 dirSum;   // Sum of the directions
+    uint32_t first;     // Entries [first, end) of the index
+    uint32_t end;
+    uint32_t child;     // First of childCount consecutive children, 0 for a leaf
+    uint32_t childCount;
+};
+
+// Bees near a point, summed (see SwarmIndex::sumNear)
+struct SwarmSums {
+    glm::vec3 pos;  // Sum of the positions
+    glm::vec3 dir;  // Sum of the directions
+    float count;    // Bees summed
+
+    SwarmSums() : pos(0.0f), dir(0.0f), count(0.0f) {}
+};
+
+// The swarm as seen by one tick: every bee's position and direction in Morton
+// order, so bees close in space are close in memory, and as queries are issued
+// in the same order, consecutive ones read the same entries. ids maps entries
+// back to swarm indices, which stay stable for everything outside, and rank
+// maps them the other way.
+//
+// Runs of equal code prefixes form an octree (a node splits where its codes
+// first differ, so every inner node has at least two children) whose nodes
+// carry bounds and position and direction totals. forEachNear() walks it to
+// the bees near a point. sumNear() takes nodes wholly inside the radius from
+// their totals, and with theta > 0 also takes distant nodes as a whole,
+// Barnes-Hut style, when they look smaller than theta from the query point.
+struct SwarmIndex {
+    static const uint32_t leafSize = 8; // Largest run kept as one leaf
+
+    MortonGrid grid;
+    Span<uint64_t> codes;    // Sorted Morton codes
+    Span<glm::vec3> pos;     // Positions, parallel to codes
+    Span<glm::vec3> dir;     // Directions, parallel to codes
+    Span<uint32_t> ids;      // Swarm index of each entry
+    Span<uint32_t> rank;     // Entry of each swarm index
+    Span<SwarmNode> nodes;   // Octree, root first
+    float theta = 0.0f;      // Opening angle for sumNear, 0 for exact sums
+
+    size_t size() const {
+        return codes.size;
+    }
+
+    // Snapshot `swarm` (anything indexable holding pointers to bees) into
+    // `arena`, sorted with `order`. Valid until the arena is reset.
+    template <typename Swarm>
+    void build(const Swarm& swarm, const MortonGrid& g, MortonOrder& order, FrameArena& arena) {
+        grid = g;
+        size_t count = swarm.size();
+        uint64_t* keys = arena.alloc<uint64_t>(count);
+        for (size_t i = 0; i < count; i++) keys[i] = grid.code(swarm[i]->getPosition());
+        ids = order.sort(keys, count, arena);
+
+        uint64_t* sortedCodes = arena.alloc<uint64_t>(count);
+        glm::vec3* sortedPos = arena.alloc<glm::vec3>(count);
+        glm::vec3* sortedDir = arena.alloc<glm::vec3>(count);
+        uint32_t* ranks = arena.alloc<uint32_t>(count);
+        for (size_t k = 0; k < count; k++) {
+            uint32_t id = ids[k];
+            ranks[id] = (uint32_t)k;
+            sortedCodes[k] = keys[id];
+            sortedPos[k] = swarm[id]->getPosition();
+            sortedDir[k] = swarm[id]->getDirection();
+        }
+        codes = Span<uint64_t>(sortedCodes, count);
+        pos = Span<glm::vec3>(sortedPos, count);
+        dir = Span<glm::vec3>(sortedDir, count);
+        rank = Span<uint32_t>(ranks, count);
+
+        // Inner nodes have two or more children, so 2 * count - 1 nodes at most
+        SwarmNode* tree = arena.alloc<SwarmNode>(count > 0 ? 2 * count : 1);
+        uint32_t used = 1;
+        if (count > 0) buildNode(tree, used, 0, 0, (uint32_t)count);
+        nodes = Span<SwarmNode>(tree, count > 0 ? used : 0);
+    }
+
+    // Totals of the bees within r of p. Exact when theta is 0, apart from the
+    // order of the additions.
+    SwarmSums sumNear(const glm::vec3& p, float r) const {
+        SwarmSums sums;
+        if (nodes.size == 0) return sums;
+        uint32_t stack[8 * (MortonGrid::bits + 2)]; // Depth is at most bits + 1 levels of up to 8 children
+        int top = 0;
+        stack[top++] = 0;
+        float r2 = r * r;
+        while (top > 0) {
+            const SwarmNode& node = nodes[stack[--top]];
+            // Squared distances from p to the nearest and farthest points of the bounds
+            float nx = std::max(std::max(node.min.x - p.x, p.x - node.max.x), 0.0f);
+            float ny = std::max(std::max(node.min.y - p.y, p.y - node.max.y), 0.0f);
+            float nz = std::max(std::max(node.min.z - p.z, p.z - node.max.z), 0.0f);
+            if (!(nx * nx + ny * ny + nz * nz < r2)) {
+                continue; // Out of reach
+            }
+            float fx = std::max(p.x - node.min.x, node.max.x - p.x);
+            float fy = std::max(p.y - node.min.y, node.max.y - p.y);
+            float fz = std::max(p.z - node.min.z, node.max.z - p.z);
+            float count = (float)(node.end - node.first);
+            if (fx * fx + fy * fy + fz * fz < r2) {
+                sums.pos += node.posSum; // Wholly inside
+                sums.dir += node.dirSum;
+                sums.count += count;
+                continue;
+            }
+            if (node.child == 0) {
+                for (uint32_t k = node.first; k < node.end; k++) {
+                    glm::vec3 offset = pos[k] - p;
+                    if (glm::dot(offset, offset) < r2) {
+                        sums.pos += pos[k];
+                        sums.dir += dir[k];
+                        sums.count += 1.0f;
+                    }
+                }
+                continue;
+            }
+            if (theta > 0.0f) {
+                glm::vec3 extent = node.max - node.min;
+                float side = std::max(extent.x, std::max(extent.y, extent.z));
+                float distance = glm::length(node.posSum / count - p);
+                if (side < theta * distance) {
+                    if (distance < r) {
+                        sums.pos += node.posSum; // Far and small: all in or all out by its centroid
+                        sums.dir += node.dirSum;
+                        sums.count += count;
+                    }
+                    continue;
+                }
+            }
+            for (uint32_t c = 0; c < node.childCount; c++) {
+                stack[top++] = node.child + c;
+            }
+        }
+        return sums;
+    }
+
+    // Call visit(k) for every entry closer than r to p. Walks the octree, so
+    // the cost follows the number of bees near p rather than the swarm size.
+    template <typename F>
+    void forEachNear(const glm::vec3& p, float r, F visit) const {
+        if (nodes.size == 0) return;
+        uint32_t stack[8 * (MortonGrid::bits + 2)];
+        int top = 0;
+        stack[top++] = 0;
+        float r2 = r * r;
+        while (top > 0) {
+            const SwarmNode& node = nodes[stack[--top]];
+            float nx = std::max(std::max(node.min.x - p.x, p.x - node.max.x), 0.0f);
+            float ny = std::max(std::max(node.min.y - p.y, p.y - node.max.y), 0.0f);
+            float nz = std::max(std::max(node.min.z - p.z, p.z - node.max.z), 0.0f);
+            if (!(nx * nx + ny * ny + nz * nz < r2)) {
+                continue; // Out of reach
+            }
+            if (node.child == 0) {
+                for (uint32_t k = node.first; k < node.end; k++) {
+                    glm::vec3 offset = pos[k] - p;
+                    if (glm::dot(offset, offset) < r2) visit(k);
+                }
+                continue;
+            }
+            for (uint32_t c = node.childCount; c-- > 0;) {
+                stack[top++] = node.child + c; // First child on top, so entries come in Morton order
+            }
+        }
+    }
+
+private:
+    // Fill tree[id] with entries [first, end), allocating its children from `used`
+    void buildNode(SwarmNode* tree, uint32_t& used, uint32_t id, uint32_t first, uint32_t end) {
+        SwarmNode& node = tree[id];
+        node.first = first;
+        node.end = end;
+        node.child = 0;
+        node.childCount = 0;
+        uint64_t diff = codes[first] ^ codes[end - 1];
+        if (end - first > leafSize && diff != 0) {
+            // Split on the highest octant digit where the run's codes differ
+            int bit = 0;
+            while (diff >> (bit + 1)) bit++;
+            int shift = bit / 3 * 3;
+            uint32_t bounds[9];
+            uint32_t children = 0;
+            bounds[0] = first;
+            while (bounds[children] < end) {
+                uint64_t next = ((codes[bounds[children]] >> shift) + 1) << shift;
+                bounds[children + 1] = (uint32_t)(std::lower_bound(codes.begin() + bounds[children], codes.begin() + end, next) - codes.begin());
+                children++;
+            }
+            node.child = used;
+            node.childCount = children;
+            used += children;
+            node.min = glm::vec3(INFINITY);
+            node.max = glm::vec3(-INFINITY);
+            node.posSum = glm::vec3(0.0f);
+            node.dirSum = glm::vec3(0.0f);
+            for (uint32_t c = 0; c < children; c++) {
+                buildNode(tree, used, node.child + c, bounds[c], bounds[c + 1]);
+                const SwarmNode& child = tree[node.child + c];
+                node.min = glm::min(node.min, child.min);
+                node.max = glm::max(node.max, child.max);
+                node.posSum += child.posSum;
+                node.dirSum += child.dirSum;
+            }
+            return;
+        }
+        // std::min/max keep the bound when a position is NaN, so a lost bee
+        // can't hide the rest of its leaf from queries
+        node.min = glm::vec3(INFINITY);
+        node.max = glm::vec3(-INFINITY);
+        node.posSum = glm::vec3(0.0f);
+        node.dirSum = glm::vec3(0.0f);
+        for (uint32_t k = first; k < end; k++) {
+            const glm::vec3& q = pos[k];
+            node.min = glm::vec3(std::min(node.min.x, q.x), std::min(node.min.y, q.y), std::min(node.min.z, q.z));
+            node.max = glm::vec3(std::max(node.max.x, q.x), std::max(node.max.y, q.y), std::max(node.max.z, q.z));
+            node.posSum += pos[k];
+            node.dirSum += dir[k];
+        }
+    }
+};
\ No newline at end of file
@@ -0,0 +1,148 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+
+// Log-linear histogram of microsecond durations. Writers only do relaxed
+// fetch_adds, the publisher drains it with exchange(0) once per interval.
+class AtomicHistogram {
+private:
+    static const int subBuckets = 8;
+    static const int bucketCount = 64 * subBuckets;
+    std::atomic<uint32_t> counts[bucketCount];
+    std::atomic<uint64_t> maxUs;
+
+    static int bucketOf(uint64_t us) {
+        if (us < subBuckets) return (int)us;
+        int exp = 63;
+        while (!(us >> exp)) exp--;
+        int sub = (int)((us >> (exp - 3)) & (subBuckets - 1));
+        return (exp - 2) * subBuckets + sub;
+    }
+
+    static uint64_t valueOf(int bucket) {
+        if (bucket < subBuckets) return bucket;
+        int exp = bucket / subBuckets + 2;
+        int sub = bucket % subBuckets;
+        return ((uint64_t)(subBuckets + sub) << (exp - 3));
+    }
+
+public:
+    // Drained copy of the histogram, read by the publisher only
+    struct Snapshot {
+        uint32_t counts[bucketCount];
+        uint64_t total;
+        uint64_t maxUs;
+
+        // Approximate value at quantile q in [0, 1]
+        uint64_t percentile(double q) const {
+            if (total == 0) return 0;
+            uint64_t rank = (uint64_t)(q * (total - 1)) + 1;
+            uint64_t seen = 0;
+            for (int b = 0; b < bucketCount; b++) {
+                seen += counts[b];
+                if (seen >= rank) return valueOf(b) < maxUs ? valueOf(b) : maxUs;
+            }
+            return maxUs;
+        }
+    };
+
+    AtomicHistogram() : maxUs(0) {
+        for (auto& c : counts) c.store(0, std::memory_order_relaxed);
+    }
+
+    void record(uint64_t us) {
+        counts[bucketOf(us)].fetch_add(1, std::memory_order_relaxed);
+        uint64_t prev = maxUs.load(std::memory_order_relaxed);
+        while (us > prev && !maxUs.compare_exchange_weak(prev, us, std::memory_order_relaxed)) {}
+    }
+
+    // Move the samples recorded since the last drain into `out`
+    void drain(Snapshot& out) {
+        out.total = 0;
+        for (int b = 0; b < bucketCount; b++) {
+            out.counts[b] = counts[b].exchange(0, std::memory_order_relaxed);
+            out.total += out.counts[b];
+        }
+        out.maxUs = maxUs.exchange(0, std::memory_order_relaxed);
+    }
+};
+
+// Live counters and gauges. The simulation and renderer update these with
+// relaxed atomics only; TelemetryPublisher reads them from its own thread.
+struct TelemetryCounters {
+    std::atomic<int> beesAlive;             // Gauge: swarm size
+    std::atomic<int> beesReturning;         // Gauge: bees carrying pollen home
+    std::atomic<int> flowers;               // Gauge: flowers alive
+    std::atomic<int> hivePollen;            // Gauge: pollen counted towards hive growth
+    std::atomic<long long> pollenDelivered; // Counter: pollen brought to the hive
+    std::atomic<long long> beesBorn;        // Counter: bees spawned after startup
+    std::atomic<long long> spawnsCapped;    // Counter: spawns skipped for the memory budget
+    std::atomic<long long> flowersReplaced; // Counter: flower lifecycle events
+    std::atomic<long long> ticks;           // Counter: simulation ticks
+    std::atomic<long long> frames;          // Counter: presented frames
+    std::atomic<long long> drawCalls;       // Counter: glDrawElements calls
+    std::atomic<long long> frameAllocs;     // Counter: heap allocations on the main thread
+    std::atomic<int> lodNear;               // Gauge: bees near the camera (steered every tick)
+    std::atomic<int> lodBusy;               // Gauge: bees near flowers, the hive or the bounds (steered every tick)
+    std::atomic<int> lodTransit;            // Gauge: bees in open transit (time-sliced)
+    std::atomic<long long> lodSteers;       // Counter: full steering updates
+    std::atomic<long long> lodCapped;       // Counter: steering updates deferred by the per-tick cap
+    std::atomic<long long> nectarCollected; // Counter: loads of nectar bees took from flowers
+    std::atomic<long long> nectarContended; // Counter: nectar claims lost to another bee at the same flower
+    std::atomic<int> busiestFlower;         // Gauge: most claims a living flower has turned away
+    AtomicHistogram tickUs;                 // Simulation tick durations
+
+    TelemetryCounters()
+        : beesAlive(0), beesReturning(0), flowers(0), hivePollen(0), pollenDelivered(0),
+        beesBorn(0), spawnsCapped(0), flowersReplaced(0), ticks(0), frames(0), drawCalls(0), frameAllocs(0),
+        lodNear(0), lodBusy(0), lodTransit(0), lodSteers(0), lodCapped(0),
+        nectarCollected(0), nectarContended(0), busiestFlower(0) {}
+};
+
+// Process-wide counters
+inline TelemetryCounters& telemetry() {
+    static TelemetryCounters counters;
+    return counters;
+}
+
+// Relaxed increment, the only operation the hot path needs
+template <typename T, typename V>
+inline void telemetryAdd(std::atomic<T>& counter, V value) {
+    counter.fetch_add((T)value, std::memory_order_relaxed);
+}
+
+// Relaxed gauge update
+template <typename T, typename V>
+inline void telemetrySet(std::atomic<T>& gauge, V value) {
+    gauge.store((T)value, std::memory_order_relaxed);
+}
+
+// Background thread that snapshots telemetry() every interval and writes one
+// JSON object per line to a file ("file:path" or a bare path) or to a Unix
+// domain socket ("unix:path", reconnected whenever the listener goes away).
+class TelemetryPublisher {
+private:
+    std::string target;          // Sink description from the command line
+    int intervalMs;              // Publishing interval
+    std::thread worker;          // Publishing thread
+    std::mutex mutex;            // Guards stopping
+    std::condition_variable wake; // Signalled on stop
+    bool stopping;               // Set by stop()
+
+    void run();
+
+public:
+    TelemetryPublisher(const std::string& target, int intervalMs);
+    ~TelemetryPublisher();
+
+    // Start publishing; false if the target is malformed
+    bool start();
+
+    // Publish a final snapshot and join the thread
+    void stop();
+};
\ No newline at end of file
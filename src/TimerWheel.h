@@ -0,0 +1,218 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+// Hierarchical timer wheel over simulation time. Four levels of 64 slots at
+// 1 ms resolution reach 4.6 hours ahead; later events wait in an overflow list.
+// Scheduling and cancelling are O(1), advancing visits one level-0 slot per
+// elapsed millisecond and cascades the higher levels as their slots come due.
+// Nodes are pooled, so a wheel with a steady number of events never allocates.
+class TimerWheel {
+public:
+    typedef uint32_t Handle;              // Identifies a scheduled event
+    static const Handle none = 0xFFFFFFFF; // Handle of no event
+
+    // Event handed to advance()'s callback
+    struct Fired {
+        double due; // Scheduled time (seconds)
+        int kind;   // Caller-defined event type, also the tie-break for equal times
+    };
+
+private:
+    static const int slotBits = 6;
+    static const int slots = 1 << slotBits;
+    static const int levels = 4;
+    static const uint32_t endOfList = 0xFFFFFFFF;
+
+    static const int unlinked = -1; // Node.list of nodes in the overflow or due lists
+
+    struct Node {
+        uint64_t due;  // Due time in wheel units
+        int kind;      // Caller's event type
+        bool live;     // Cleared by cancel(); unlinked dead nodes are reclaimed when their list is visited
+        int list;      // level * slots + slot of the slot list holding the node, or unlinked
+        uint32_t prev; // Previous node in the same slot
+        uint32_t next; // Next node in the same slot, or in the free list
+    };
+
+    double resolution;              // Seconds per wheel unit
+    uint64_t now;                   // Last time advanced to, in wheel units
+    std::vector<Node> nodes;        // Event pool
+    uint32_t freeList;              // Unused nodes
+    uint32_t heads[levels][slots];  // Slot lists
+    std::vector<uint32_t> overflow; // Events beyond the top level
+    std::vector<uint32_t> due;      // Events expiring in the current advance()
+    int liveCount;                  // Scheduled, uncancelled events
+
+    uint64_t toUnits(double seconds) const {
+        return seconds <= 0.0 ? 0 : (uint64_t)std::ceil(seconds / resolution - 1e-9);
+    }
+
+    // File a node under the slot its due time falls in, relative to `now`
+    void place(uint32_t id) {
+        uint64_t t = nodes[id].due;
+        if (t <= now) {
+            t = now + 1; // Already due: fire on the next advance
+        }
+        for (int level = 0; level < levels; level++) {
+            int shift = slotBits * (level + 1);
+            if ((t >> shift) == (now >> shift)) {
+                int slot = (int)((t >> (slotBits * level)) & (slots - 1));
+                uint32_t head = heads[level][slot];
+                nodes[id].list = level * slots + slot;
+                nodes[id].prev = endOfList;
+                nodes[id].next = head;
+                if (head != endOfList) nodes[head].prev = id;
+                heads[level][slot] = id;
+                return;
+            }
+        }
+        nodes[id].list = unlinked;
+        overflow.push_back(id);
+    }
+
+    // Take a node out of its slot list
+    void unlink(uint32_t id) {
+        Node& node = nodes[id];
+        if (node.prev != endOfList) nodes[node.prev].next = node.next;
+        else heads[node.list / slots][node.list % slots] = node.next;
+        if (node.next != endOfList) nodes[node.next].prev = node.prev;
+        node.list = unlinked;
+    }
+
+    void release(uint32_t id) {
+        nodes[id].live = false;
+        nodes[id].next = freeList;
+        freeList = id;
+    }
+
+    // Re-file every node of one slot (cascade), or collect it if it is due
+    void drain(int level, int slot) {
+        uint32_t id = heads[level][slot];
+        heads[level][slot] = endOfList;
+        while (id != endOfList) {
+            uint32_t next = nodes[id].next;
+            nodes[id].list = unlinked;
+            if (nodes[id].due <= now) {
+                due.push_back(id);
+            }
+            else {
+                place(id);
+            }
+            id = next;
+        }
+    }
+
+public:
+    explicit TimerWheel(double resolution = 0.001)
+        : resolution(resolution), now(0), freeList(endOfList), liveCount(0) {
+        nodes.reserve(16);
+        due.reserve(16);
+        clear(0.0);
+    }
+
+    // Drop every event and restart the wheel at time `at` (seconds)
+    void clear(double at) {
+        now = (uint64_t)std::floor(at / resolution + 1e-9);
+        nodes.clear();
+        overflow.clear();
+        freeList = endOfList;
+        liveCount = 0;
+        for (auto& level : heads) {
+            for (auto& head : level) head = endOfList;
+        }
+    }
+
+    // Schedule an event of type `kind` at time `at` (seconds)
+    Handle schedule(double at, int kind) {
+        uint32_t id;
+        if (freeList != endOfList) {
+            id = freeList;
+            freeList = nodes[id].next;
+        }
+        else {
+            id = (uint32_t)nodes.size();
+            nodes.push_back(Node());
+        }
+        nodes[id].due = toUnits(at);
+        nodes[id].kind = kind;
+        nodes[id].live = true;
+        place(id);
+        liveCount++;
+        return id;
+    }
+
+    // Cancel a pending event. `handle` must not have fired yet.
+    void cancel(Handle& handle) {
+        if (handle != none && nodes[handle].live) {
+            liveCount--;
+            if (nodes[handle].list != unlinked) {
+                unlink(handle);
+                release(handle);
+            }
+            else {
+                nodes[handle].live = false; // Overflow or due list, reclaimed there
+            }
+        }
+        handle = none;
+    }
+
+    bool empty() const {
+        return liveCount == 0;
+    }
+
+    // Move the clock to `to` (seconds) and call fire(Fired) for every event that
+    // came due, ordered by due time and then kind so the order is reproducible.
+    // Events scheduled from the callback at or before `to` fire on the next call.
+    template <typename F>
+    void advance(double to, F fire) {
+        uint64_t target = (uint64_t)std::floor(to / resolution + 1e-9);
+        if (target <= now) {
+            return;
+        }
+        if (liveCount == 0) {
+            now = target; // Nothing to cascade or fire
+            return;
+        }
+        const uint64_t topSpan = (uint64_t)1 << (slotBits * levels);
+        due.clear();
+        while (now < target) {
+            now++;
+            if ((now & (topSpan - 1)) == 0 && !overflow.empty()) {
+                std::vector<uint32_t> distant;
+                distant.swap(overflow);
+                for (uint32_t id : distant) {
+                    if (!nodes[id].live) release(id);
+                    else place(id);
+                }
+            }
+            // Entering a new block of a level: pull its slot down one level
+            for (int level = levels - 1; level >= 1; level--) {
+                uint64_t span = (uint64_t)1 << (slotBits * level);
+                if ((now & (span - 1)) == 0) {
+                    drain(level, (int)((now >> (slotBits * level)) & (slots - 1)));
+                }
+            }
+            drain(0, (int)(now & (slots - 1)));
+        }
+
+        std::sort(due.begin(), due.end(), [this](uint32_t a, uint32_t b) {
+            return nodes[a].due != nodes[b].due ? nodes[a].due < nodes[b].due : nodes[a].kind < nodes[b].kind;
+        });
+        for (uint32_t id : due) {
+            if (!nodes[id].live) {
+                release(id); // Cancelled by an earlier callback
+                continue;
+            }
+            Fired f;
+            f.due = nodes[id].due * resolution;
+            f.kind = nodes[id].kind;
+            release(id);
+            liveCount--;
+            fire(f);
+        }
+    }
+};
\ No newline at end of file
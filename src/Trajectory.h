@@ -0,0 +1,613 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Checkpoint.h"
+#include "VertexPacking.h"
+
+// Trajectory file: per-tick bee positions, headings and states for offline
+// analysis and replay. Frames are grouped into chunks of framesPerChunk; the
+// first frame of a chunk is a keyframe, the rest are deltas against the
+// previous frame, so any chunk decodes on its own (seeking). Each chunk's
+// bytes are entropy coded with a static rANS model stored in the chunk.
+//
+//   file   = "BEETRAJ\0" u32 version u32 framesPerChunk f32 boxMin[3] f32 boxMax[3]
+//            u32 terrainSize terrain, chunk*, index
+//   chunk  = u32 'CHNK' u32 firstTick u32 frameCount u32 rawSize u32 codedSize
+//            varint freq[256], coded
+//   index  = u32 'INDX' u32 chunkCount (u64 offset u32 firstTick u32 frameCount)*
+//            u64 indexOffset u32 'TEND'
+//
+// A file without an index (the recorder did not shut down) is still readable;
+// the reader rebuilds the index by walking the chunks.
+namespace trajectory {
+
+const uint32_t version = 1;
+const uint32_t framesPerChunk = 64;
+const uint32_t chunkMagic = 0x4B4E4843; // "CHNK"
+const uint32_t indexMagic = 0x58444E49; // "INDX"
+const uint32_t endMagic = 0x444E4554;   // "TEND"
+
+// One bee in one frame
+struct BeeSample {
+    glm::vec3 p;    // Position
+    glm::vec3 d;    // Heading
+    bool returning; // Carrying pollen home
+};
+
+// One recorded tick
+struct Frame {
+    uint32_t tick;                  // Simulation tick
+    int32_t pollen;                 // Hive pollen (drives the hive size)
+    bool flowersChanged;            // flowers holds the new flower set
+    std::vector<glm::vec3> flowers; // Flower positions, when flowersChanged
+    std::vector<BeeSample> bees;    // Every bee, in swarm order
+};
+
+// Quantized bee: 16-bit position in the recording box, octahedral heading
+struct QuantBee {
+    int32_t p[3];
+    int32_t d[2];
+    uint8_t state;
+};
+
+// Position quantization box: the flight volume plus a margin for bees that stray
+struct Box {
+    glm::vec3 min;
+    glm::vec3 max;
+
+    int32_t quantize(float v, int c) const {
+        float t = (v - min[c]) / (max[c] - min[c]);
+        t = t < 0.0f ? 0.0f : (t > 1.0f ? 1.0f : t);
+        return (int32_t)std::round(t * 65535.0f);
+    }
+
+    float dequantize(int32_t q, int c) const {
+        return min[c] + (max[c] - min[c]) * (q / 65535.0f);
+    }
+};
+
+inline Box boxFor(const BoundBox& bounds) {
+    glm::vec3 margin = (bounds.max - bounds.min) * 0.5f + glm::vec3(1.0f);
+    return { bounds.min - margin, bounds.max + margin };
+}
+
+inline void putVarint(std::string& out, uint32_t v) {
+    while (v >= 0x80) {
+        out.push_back((char)(v | 0x80));
+        v >>= 7;
+    }
+    out.push_back((char)v);
+}
+
+inline uint32_t getVarint(const std::string& in, size_t& pos) {
+    uint32_t v = 0;
+    for (int shift = 0; shift < 35 && pos < in.size(); shift += 7) {
+        uint8_t b = (uint8_t)in[pos++];
+        v |= (uint32_t)(b & 0x7F) << shift;
+        if (!(b & 0x80)) break;
+    }
+    return v;
+}
+
+inline uint32_t zigzag(int32_t v) {
+    return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31);
+}
+
+inline int32_t unzigzag(uint32_t v) {
+    return (int32_t)(v >> 1) ^ -(int32_t)(v & 1);
+}
+
+// Static-model rANS over bytes (32-bit state, byte-wise renormalization)
+namespace rans {
+
+const uint32_t scaleBits = 12;
+const uint32_t scale = 1u << scaleBits;
+const uint32_t lower = 1u << 23;
+
+// Symbol frequencies normalized to sum to `scale`, every present symbol >= 1
+inline void buildFrequencies(const std::string& data, uint32_t freq[256]) {
+    uint64_t counts[256] = { 0 };
+    for (unsigned char c : data) counts[c]++;
+
+    uint32_t sum = 0;
+    int largest = 0;
+    for (int s = 0; s < 256; s++) {
+        freq[s] = counts[s] ? (uint32_t)(counts[s] * scale / data.size()) : 0;
+        if (counts[s] && freq[s] == 0) freq[s] = 1;
+        sum += freq[s];
+        if (freq[s] > freq[largest]) largest = s;
+    }
+    // Give the rounding error to the most frequent symbols
+    while (sum > scale) {
+        for (int s = 0; s < 256 && sum > scale; s++) {
+            if (freq[s] > 1 && freq[s] * 4 >= freq[largest]) {
+                freq[s]--;
+                sum--;
+            }
+        }
+    }
+    freq[largest] += scale - sum;
+}
+
+inline std::string encode(const std::string& data, const uint32_t freq[256]) {
+    uint32_t cum[256];
+    uint32_t total = 0;
+    for (int s = 0; s < 256; s++) {
+        cum[s] = total;
+        total += freq[s];
+    }
+
+    std::vector<uint8_t> buffer(data.size() * 2 + 16);
+    uint8_t* end = buffer.data() + buffer.size();
+    uint8_t* ptr = end;
+    uint32_t x = lower;
+    for (size_t i = data.size(); i-- > 0;) {
+        unsigned char s = (unsigned char)data[i];
+        uint32_t xMax = ((lower >> scaleBits) << 8) * freq[s];
+        while (x >= xMax) {
+            *--ptr = (uint8_t)(x & 0xFF);
+            x >>= 8;
+        }
+        x = ((x / freq[s]) << scaleBits) + (x % freq[s]) + cum[s];
+    }
+    ptr -= 4;
+    ptr[0] = (uint8_t)(x >> 0);
+    ptr[1] = (uint8_t)(x >> 8);
+    ptr[2] = (uint8_t)(x >> 16);
+    ptr[3] = (uint8_t)(x >> 24);
+    return std::string(reinterpret_cast<const char*>(ptr), end - ptr);
+}
+
+inline bool decode(const std::string& coded, const uint32_t freq[256], size_t rawSize, std::string& out) {
+    uint32_t cum[256];
+    std::vector<uint8_t> symbolOf(scale);
+    uint32_t total = 0;
+    for (int s = 0; s < 256; s++) {
+        cum[s] = total;
+        for (uint32_t k = 0; k < freq[s] && total + k < scale; k++) symbolOf[total + k] = (uint8_t)s;
+        total += freq[s];
+    }
+    if (total != scale || coded.size() < 4) {
+        return false;
+    }
+
+    const uint8_t* ptr = reinterpret_cast<const uint8_t*>(coded.data());
+    const uint8_t* end = ptr + coded.size();
+    uint32_t x = ptr[0] | (ptr[1] << 8) | (ptr[2] << 16) | ((uint32_t)ptr[3] << 24);
+    ptr += 4;
+    out.resize(rawSize);
+    for (size_t i = 0; i < rawSize; i++) {
+        uint32_t slot = x & (scale - 1);
+        uint8_t s = symbolOf[slot];
+        out[i] = (char)s;
+        x = freq[s] * (x >> scaleBits) + slot - cum[s];
+        while (x < lower) {
+            if (ptr == end) return false;
+            x = (x << 8) | *ptr++;
+        }
+    }
+    return true;
+}
+
+}
+
+inline QuantBee quantizeBee(const BeeSample& b, const Box& box) {
+    QuantBee q;
+    for (int c = 0; c < 3; c++) q.p[c] = box.quantize(b.p[c], c);
+    glm::vec2 oct = octEncode(b.d);
+    q.d[0] = packSnorm(oct.x, 127);
+    q.d[1] = packSnorm(oct.y, 127);
+    q.state = b.returning ? 1 : 0;
+    return q;
+}
+
+// Serialize a chunk's frames (keyframe first) into the pre-entropy byte stream.
+// Fields are written column by column so similar deltas sit next to each other.
+inline std::string encodeFrames(const std::vector<Frame>& frames, const Box& box) {
+    std::string out;
+    std::vector<QuantBee> prev;
+    std::vector<QuantBee> cur;
+    uint32_t prevTick = 0;
+    for (size_t f = 0; f < frames.size(); f++) {
+        const Frame& frame = frames[f];
+        putVarint(out, f == 0 ? frame.tick : frame.tick - prevTick);
+        prevTick = frame.tick;
+        putVarint(out, zigzag(frame.pollen));
+        out.push_back((char)(frame.flowersChanged ? 1 : 0));
+        if (frame.flowersChanged) {
+            putVarint(out, (uint32_t)frame.flowers.size());
+            for (const auto& fp : frame.flowers) {
+                for (int c = 0; c < 3; c++) putVarint(out, box.quantize(fp[c], c));
+            }
+        }
+
+        cur.resize(frame.bees.size());
+        for (size_t i = 0; i < frame.bees.size(); i++) cur[i] = quantizeBee(frame.bees[i], box);
+        putVarint(out, (uint32_t)cur.size());
+        for (int c = 0; c < 3; c++) {
+            for (size_t i = 0; i < cur.size(); i++) {
+                putVarint(out, zigzag(cur[i].p[c] - (i < prev.size() ? prev[i].p[c] : 0)));
+            }
+        }
+        for (int c = 0; c < 2; c++) {
+            for (size_t i = 0; i < cur.size(); i++) {
+                putVarint(out, zigzag(cur[i].d[c] - (i < prev.size() ? prev[i].d[c] : 0)));
+            }
+        }
+        for (size_t i = 0; i < cur.size(); i++) {
+            out.push_back((char)(cur[i].state ^ (i < prev.size() ? prev[i].state : 0)));
+        }
+        prev.swap(cur);
+    }
+    return out;
+}
+
+inline bool decodeFrames(const std::string& in, uint32_t frameCount, const Box& box, std::vector<Frame>& frames) {
+    frames.assign(frameCount, Frame());
+    std::vector<QuantBee> prev;
+    std::vector<QuantBee> cur;
+    size_t pos = 0;
+    uint32_t prevTick = 0;
+    for (uint32_t f = 0; f < frameCount; f++) {
+        Frame& frame = frames[f];
+        uint32_t tick = getVarint(in, pos);
+        frame.tick = f == 0 ? tick : prevTick + tick;
+        prevTick = frame.tick;
+        frame.pollen = unzigzag(getVarint(in, pos));
+        if (pos >= in.size()) return false;
+        frame.flowersChanged = in[pos++] != 0;
+        if (frame.flowersChanged) {
+            uint32_t count = getVarint(in, pos);
+            if (count > in.size()) return false;
+            frame.flowers.resize(count);
+            for (auto& fp : frame.flowers) {
+                for (int c = 0; c < 3; c++) fp[c] = box.dequantize((int32_t)getVarint(in, pos), c);
+            }
+        }
+
+        uint32_t count = getVarint(in, pos);
+        if (count > in.size()) return false;
+        cur.resize(count);
+        for (int c = 0; c < 3; c++) {
+            for (uint32_t i = 0; i < count; i++) {
+                cur[i].p[c] = unzigzag(getVarint(in, pos)) + (i < prev.size() ? prev[i].p[c] : 0);
+            }
+        }
+        for (int c = 0; c < 2; c++) {
+            for (uint32_t i = 0; i < count; i++) {
+                cur[i].d[c] = unzigzag(getVarint(in, pos)) + (i < prev.size() ? prev[i].d[c] : 0);
+            }
+        }
+        for (uint32_t i = 0; i < count; i++) {
+            if (pos >= in.size()) return false;
+            cur[i].state = (uint8_t)in[pos++] ^ (i < prev.size() ? prev[i].state : 0);
+        }
+
+        frame.bees.resize(count);
+        for (uint32_t i = 0; i < count; i++) {
+            BeeSample& b = frame.bees[i];
+            for (int c = 0; c < 3; c++) b.p[c] = box.dequantize(cur[i].p[c], c);
+            b.d = octDecode(glm::vec2(cur[i].d[0] / 127.0f, cur[i].d[1] / 127.0f));
+            b.returning = cur[i].state != 0;
+        }
+        prev.swap(cur);
+    }
+    return pos == in.size();
+}
+
+}
+
+// Records the swarm every tick. record() copies the bee samples and queues
+// them; a background thread quantizes, delta-encodes, entropy codes and
+// writes whole chunks, then the seek index when the recorder is destroyed.
+class TrajectoryRecorder {
+private:
+    struct ChunkEntry {
+        uint64_t offset;
+        uint32_t firstTick;
+        uint32_t frameCount;
+    };
+
+    FILE* file;                             // Output file, null if it failed to open
+    uint64_t written;                       // Bytes written so far (ftell is 32-bit on Windows)
+    trajectory::Box box;                    // Position quantization box
+    std::thread worker;                     // Encoder/writer thread
+    std::mutex mutex;                       // Guards queue and stopping
+    std::condition_variable wake;           // Signalled on record and stop
+    std::deque<trajectory::Frame> queue;    // Frames waiting for the writer
+    bool stopping;                          // Set by the destructor
+
+    std::vector<glm::vec3> lastFlowers;     // Flower set in the previous record() call (main thread)
+
+    // Writer-thread state
+    std::vector<trajectory::Frame> chunk;   // Frames of the chunk being built
+    std::vector<glm::vec3> currentFlowers;  // Flower set, repeated in every keyframe
+    std::vector<ChunkEntry> index;          // Seek index
+
+    void writeChunk() {
+        using namespace trajectory;
+        if (chunk.empty()) return;
+
+        std::string raw = encodeFrames(chunk, box);
+        uint32_t freq[256];
+        rans::buildFrequencies(raw, freq);
+        std::string coded = rans::encode(raw, freq);
+
+        std::string header;
+        uint32_t fields[5] = { chunkMagic, chunk.front().tick, (uint32_t)chunk.size(), (uint32_t)raw.size(), (uint32_t)coded.size() };
+        header.append(reinterpret_cast<const char*>(fields), sizeof(fields));
+        for (int s = 0; s < 256; s++) putVarint(header, freq[s]);
+
+        ChunkEntry entry = { written, chunk.front().tick, (uint32_t)chunk.size() };
+        fwrite(header.data(), 1, header.size(), file);
+        fwrite(coded.data(), 1, coded.size(), file);
+        written += header.size() + coded.size();
+        fflush(file);
+        index.push_back(entry);
+        chunk.clear();
+    }
+
+    void add(trajectory::Frame& frame) {
+        if (frame.flowersChanged) {
+            currentFlowers = frame.flowers;
+        }
+        else if (chunk.empty()) {
+            frame.flowersChanged = true; // Keyframes carry the flower set for seeking
+            frame.flowers = currentFlowers;
+        }
+        chunk.push_back(std::move(frame));
+        if (chunk.size() == trajectory::framesPerChunk) {
+            writeChunk();
+        }
+    }
+
+    void run() {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true) {
+            wake.wait(lock, [this]() { return !queue.empty() || stopping; });
+            if (queue.empty()) break;
+            std::deque<trajectory::Frame> batch;
+            batch.swap(queue);
+            lock.unlock();
+            for (auto& frame : batch) add(frame);
+            lock.lock();
+        }
+        lock.unlock();
+
+        writeChunk();
+        uint64_t indexOffset = written;
+        uint32_t head[2] = { trajectory::indexMagic, (uint32_t)index.size() };
+        fwrite(head, sizeof(head), 1, file);
+        for (const auto& e : index) {
+            fwrite(&e.offset, sizeof(e.offset), 1, file);
+            fwrite(&e.firstTick, sizeof(e.firstTick), 1, file);
+            fwrite(&e.frameCount, sizeof(e.frameCount), 1, file);
+        }
+        fwrite(&indexOffset, sizeof(indexOffset), 1, file);
+        fwrite(&trajectory::endMagic, sizeof(trajectory::endMagic), 1, file);
+        fclose(file);
+    }
+
+public:
+    TrajectoryRecorder(const std::string& path, const TerrainState& terrain, const BoundBox& bounds)
+        : file(fopen(path.c_str(), "wb")), written(0), box(trajectory::boxFor(bounds)), stopping(false) {
+        if (file == NULL) {
+            std::cerr << "can't open trajectory file " << path << std::endl;
+            return;
+        }
+        std::string header("BEETRAJ", 8);
+        uint32_t fields[2] = { trajectory::version, trajectory::framesPerChunk };
+        header.append(reinterpret_cast<const char*>(fields), sizeof(fields));
+        header.append(reinterpret_cast<const char*>(&box.min.x), sizeof(float) * 3);
+        header.append(reinterpret_cast<const char*>(&box.max.x), sizeof(float) * 3);
+        std::string terrainBytes = checkpoint::encodeTerrain(terrain);
+        uint32_t terrainSize = (uint32_t)terrainBytes.size();
+        header.append(reinterpret_cast<const char*>(&terrainSize), sizeof(terrainSize));
+        header += terrainBytes;
+        fwrite(header.data(), 1, header.size(), file);
+        written = header.size();
+        worker = std::thread(&TrajectoryRecorder::run, this);
+    }
+
+    // Flush the last chunk and the index
+    ~TrajectoryRecorder() {
+        if (file == NULL) return;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        worker.join();
+    }
+
+    // Queue the current tick of `sim` (main thread)
+    void record(const Simulation& sim) {
+        if (file == NULL) return;
+        trajectory::Frame frame;
+        frame.tick = (uint32_t)sim.tickCount;
+        frame.pollen = sim.plnCount;
+        frame.flowersChanged = sim.flowerPts != lastFlowers;
+        if (frame.flowersChanged) {
+            lastFlowers = sim.flowerPts;
+            frame.flowers = sim.flowerPts;
+        }
+        frame.bees.resize(sim.swarm.size());
+        for (size_t i = 0; i < sim.swarm.size(); i++) {
+            const Member& bee = *sim.swarm[i];
+            frame.bees[i].p = bee.getPosition();
+            frame.bees[i].d = bee.getDirection();
+            frame.bees[i].returning = bee.isReturningHome();
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            queue.push_back(std::move(frame));
+        }
+        wake.notify_one();
+    }
+};
+
+// Reads a trajectory file with random access by tick. Decodes one chunk at a time.
+class TrajectoryReader {
+private:
+    struct ChunkEntry {
+        uint64_t offset;
+        uint32_t firstTick;
+        uint32_t frameCount;
+    };
+
+    std::string data;                      // Whole file
+    trajectory::Box box;                   // Position quantization box
+    TerrainState terrain;                  // Terrain the run was recorded on
+    std::vector<ChunkEntry> index;         // Chunk offsets and tick ranges
+    size_t chunkStart;                     // Offset of the first chunk
+    int loadedChunk;                       // Chunk held in frames, -1 for none
+    std::vector<trajectory::Frame> frames; // Decoded frames of loadedChunk
+    std::vector<glm::vec3> flowers;        // Flower set as of the current frame
+    size_t cursor;                         // Next frame within loadedChunk
+
+    template <typename T>
+    bool read(size_t offset, T& value) const {
+        if (offset + sizeof(T) > data.size()) return false;
+        memcpy(&value, data.data() + offset, sizeof(T));
+        return true;
+    }
+
+    // Walk the chunks from the start, for files without an index
+    void scanChunks() {
+        index.clear();
+        size_t offset = chunkStart;
+        uint32_t fields[5];
+        while (read(offset, fields) && fields[0] == trajectory::chunkMagic) {
+            size_t pos = offset + sizeof(fields);
+            for (int s = 0; s < 256; s++) trajectory::getVarint(data, pos);
+            if (pos + fields[4] > data.size()) break; // Truncated chunk
+            index.push_back({ offset, fields[1], fields[2] });
+            offset = pos + fields[4];
+        }
+    }
+
+    bool loadChunk(int c) {
+        using namespace trajectory;
+        if (c == loadedChunk) return true;
+        uint32_t fields[5];
+        if (c < 0 || c >= (int)index.size() || !read((size_t)index[c].offset, fields) || fields[0] != chunkMagic) {
+            return false;
+        }
+        size_t pos = (size_t)index[c].offset + sizeof(fields);
+        uint32_t freq[256];
+        for (int s = 0; s < 256; s++) freq[s] = getVarint(data, pos);
+        if (pos + fields[4] > data.size()) return false;
+        std::string raw;
+        if (!rans::decode(data.substr(pos, fields[4]), freq, fields[3], raw) || !decodeFrames(raw, fields[2], box, frames)) {
+            std::cerr << "corrupt trajectory chunk " << c << std::endl;
+            return false;
+        }
+        loadedChunk = c;
+        return true;
+    }
+
+public:
+    TrajectoryReader() : chunkStart(0), loadedChunk(-1), cursor(0) {}
+
+    bool open(const std::string& path) {
+        FILE* fid = fopen(path.c_str(), "rb");
+        if (fid == NULL) {
+            std::cerr << "can't open trajectory file " << path << std::endl;
+            return false;
+        }
+        char buffer[65536];
+        size_t n;
+        while ((n = fread(buffer, 1, sizeof(buffer), fid)) > 0) {
+            data.append(buffer, n);
+        }
+        fclose(fid);
+
+        uint32_t fields[2];
+        uint32_t terrainSize = 0;
+        if (data.size() < 48 || memcmp(data.data(), "BEETRAJ", 8) != 0 || !read(8, fields) || fields[0] != trajectory::version) {
+            std::cerr << "not a version " << trajectory::version << " trajectory: " << path << std::endl;
+            return false;
+        }
+        memcpy(&box.min.x, data.data() + 16, sizeof(float) * 3);
+        memcpy(&box.max.x, data.data() + 28, sizeof(float) * 3);
+        read(40, terrainSize);
+        chunkStart = 44 + terrainSize;
+        if (chunkStart > data.size() || !checkpoint::decodeTerrain(data.substr(44, terrainSize), terrain)) {
+            std::cerr << "bad terrain in trajectory: " << path << std::endl;
+            return false;
+        }
+
+        // Use the index if the recorder finished, otherwise rebuild it
+        uint64_t indexOffset = 0;
+        uint32_t end = 0;
+        uint32_t head[2];
+        if (data.size() >= chunkStart + 12 && read(data.size() - 4, end) && end == trajectory::endMagic
+            && read(data.size() - 12, indexOffset) && read((size_t)indexOffset, head) && head[0] == trajectory::indexMagic) {
+            size_t pos = (size_t)indexOffset + sizeof(head);
+            for (uint32_t i = 0; i < head[1]; i++, pos += 16) {
+                ChunkEntry e;
+                if (!read(pos, e.offset) || !read(pos + 8, e.firstTick) || !read(pos + 12, e.frameCount)) break;
+                index.push_back(e);
+            }
+        }
+        else {
+            scanChunks();
+        }
+        return !index.empty() && seek(index.front().firstTick);
+    }
+
+    const TerrainState& getTerrain() const {
+        return terrain;
+    }
+
+    uint32_t firstTick() const {
+        return index.empty() ? 0 : index.front().firstTick;
+    }
+
+    uint32_t lastTick() const {
+        return index.empty() ? 0 : index.back().firstTick + index.back().frameCount - 1;
+    }
+
+    // Position the reader at the first frame with tick >= `tick` (clamped to the recording)
+    bool seek(uint32_t tick) {
+        if (index.empty()) return false;
+        int c = 0;
+        while (c + 1 < (int)index.size() && index[c + 1].firstTick <= tick) c++;
+        if (!loadChunk(c)) return false;
+        cursor = 0;
+        flowers = frames.front().flowers; // Keyframes always carry the flower set
+        while (cursor + 1 < frames.size() && frames[cursor].tick < tick) {
+            cursor++;
+            if (frames[cursor].flowersChanged) flowers = frames[cursor].flowers;
+        }
+        return true;
+    }
+
+    // Read the frame at the cursor and advance. The returned frame always
+    // carries the current flower set. False at the end of the recording.
+    bool next(trajectory::Frame& out) {
+        if (loadedChunk < 0) return false;
+        if (cursor >= frames.size()) {
+            if (!loadChunk(loadedChunk + 1)) return false;
+            cursor = 0;
+        }
+        out = frames[cursor++];
+        if (out.flowersChanged) {
+            flowers = out.flowers;
+        }
+        else {
+            out.flowers = flowers;
+        }
+        return true;
+    }
+};
\ No newline at end of file
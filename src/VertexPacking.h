@@ -0,0 +1,113 @@
+#pragma once
+#include <gl/glew.h>
+#define GLM_FORCE_RADIANS
+#include <glm/glm.hpp>
+#include <glm/gtc/type_ptr.hpp>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+
+// Compressed vertex layout shared by Object and LandMass (8 bytes per vertex).
+// Positions are 16-bit snorm values relative to the mesh bounds and normals are
+// octahedral-encoded into two 8-bit snorm values. Decoded in lab1c.vs / assign1.vs.
+struct PackedVertex {
+    GLshort position[3]; // Quantized position in [-1, 1] of the mesh bounds
+    GLbyte normal[2];    // Octahedral-encoded unit normal
+};
+
+// Dequantization parameters: position = packed * scale + offset
+struct QuantizeParams {
+    glm::vec3 scale;  // Half extent of the mesh bounds
+    glm::vec3 offset; // Centre of the mesh bounds
+};
+
+// Compute the dequantization parameters for a tightly packed xyz position array
+inline QuantizeParams computeQuantizeParams(const GLfloat* positions, int vertexCount, int stride = 3) {
+    glm::vec3 minP(std::numeric_limits<float>::max());
+    glm::vec3 maxP(std::numeric_limits<float>::lowest());
+
+    for (int i = 0; i < vertexCount; i++) {
+        const GLfloat* v = positions + i * stride;
+        for (int c = 0; c < 3; c++) {
+            if (v[c] < minP[c]) minP[c] = v[c];
+            if (v[c] > maxP[c]) maxP[c] = v[c];
+        }
+    }
+
+    QuantizeParams params;
+    if (vertexCount == 0) {
+        params.scale = glm::vec3(1.0f);
+        params.offset = glm::vec3(0.0f);
+        return params;
+    }
+    params.offset = (minP + maxP) * 0.5f;
+    params.scale = (maxP - minP) * 0.5f;
+    for (int c = 0; c < 3; c++) {
+        if (params.scale[c] < 1e-6f) params.scale[c] = 1.0f; // Flat axis, avoid dividing by zero
+    }
+    return params;
+}
+
+// Convert a value in [-1, 1] to a signed normalized integer with the given maximum
+inline int packSnorm(float value, int maxValue) {
+    value = value < -1.0f ? -1.0f : (value > 1.0f ? 1.0f : value);
+    return static_cast<int>(std::round(value * maxValue));
+}
+
+// Octahedral encoding of a unit vector into [-1, 1]^2
+inline glm::vec2 octEncode(const glm::vec3& n) {
+    float l1 = std::fabs(n.x) + std::fabs(n.y) + std::fabs(n.z);
+    if (l1 < 1e-12f) {
+        return glm::vec2(0.0f, 0.0f);
+    }
+    glm::vec2 p(n.x / l1, n.y / l1);
+    if (n.z < 0.0f) {
+        // Fold the lower hemisphere over the diagonals
+        glm::vec2 folded((1.0f - std::fabs(p.y)) * (p.x >= 0.0f ? 1.0f : -1.0f),
+                         (1.0f - std::fabs(p.x)) * (p.y >= 0.0f ? 1.0f : -1.0f));
+        p = folded;
+    }
+    return p;
+}
+
+// Inverse of octEncode (the CPU twin of octDecode in the vertex shaders)
+inline glm::vec3 octDecode(const glm::vec2& e) {
+    glm::vec3 n(e.x, e.y, 1.0f - std::fabs(e.x) - std::fabs(e.y));
+    float t = n.z < 0.0f ? -n.z : 0.0f;
+    n.x += n.x >= 0.0f ? -t : t;
+    n.y += n.y >= 0.0f ? -t : t;
+    float length = glm::length(n);
+    return length > 0.0f ? n / length : glm::vec3(0.0f, 0.0f, 1.0f);
+}
+
+// Pack a single vertex
+inline PackedVertex packVertex(const glm::vec3& position, const glm::vec3& normal, const QuantizeParams& params) {
+    PackedVertex pv;
+    for (int c = 0; c < 3; c++) {
+        pv.position[c] = static_cast<GLshort>(packSnorm((position[c] - params.offset[c]) / params.scale[c], 32767));
+    }
+    glm::vec2 oct = octEncode(normal);
+    pv.normal[0] = static_cast<GLbyte>(packSnorm(oct.x, 127));
+    pv.normal[1] = static_cast<GLbyte>(packSnorm(oct.y, 127));
+    return pv;
+}
+
+// Link the packed vertex attributes of the currently bound VBO to the program
+inline void bindPackedAttributes(GLuint program) {
+    GLint vPosition = glGetAttribLocation(program, "vPosition");
+    glVertexAttribPointer(vPosition, 3, GL_SHORT, GL_TRUE, sizeof(PackedVertex), reinterpret_cast<void*>(offsetof(PackedVertex, position)));
+    glEnableVertexAttribArray(vPosition);
+
+    GLint vNormal = glGetAttribLocation(program, "vNormal");
+    glVertexAttribPointer(vNormal, 2, GL_BYTE, GL_TRUE, sizeof(PackedVertex), reinterpret_cast<void*>(offsetof(PackedVertex, normal)));
+    glEnableVertexAttribArray(vNormal);
+}
+
+// Upload the dequantization uniforms for the program currently in use
+inline void setQuantizeUniforms(GLuint program, const QuantizeParams& params) {
+    GLint scaleLoc = glGetUniformLocation(program, "posScale");
+    glUniform3fv(scaleLoc, 1, glm::value_ptr(params.scale));
+
+    GLint offsetLoc = glGetUniformLocation(program, "posOffset");
+    glUniform3fv(offsetLoc, 1, glm::value_ptr(params.offset));
+}
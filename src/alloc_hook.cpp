@@ -0,0 +1,41 @@
+/************************************************
+ *
+ *       CSCI 4110 Project - Bee Simulation
+ *       Heap allocation hook
+ *
+ *  Replaces the global operator new and delete so
+ *  every heap allocation in the process is counted
+ *  (see AllocationHook.h). Compile this file into
+ *  a target to turn the counters on.
+ *
+ ************************************************/
+
+#include "AllocationHook.h"
+#include <cstdlib>
+#include <new>
+
+void* operator new(size_t size) {
+    AllocationCounters& counters = allocations();
+    counters.count.fetch_add(1, std::memory_order_relaxed);
+    counters.bytes.fetch_add(size, std::memory_order_relaxed);
+    threadAllocations()++;
+    void* p = std::malloc(size ? size : 1);
+    if (p == nullptr) throw std::bad_alloc();
+    return p;
+}
+void* operator new[](size_t size) { return operator new(size); }
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+    try {
+        return operator new(size);
+    }
+    catch (...) {
+        return nullptr;
+    }
+}
+void* operator new[](size_t size, const std::nothrow_t&) noexcept { return operator new(size, std::nothrow); }
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+void operator delete[](void* p, size_t) noexcept { std::free(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { std::free(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { std::free(p); }
\ No newline at end of file
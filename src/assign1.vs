@@ -2,15 +2,27 @@
 
 uniform mat4 modelView;
 uniform mat4 projection;
+uniform vec3 posScale;  // Half extent of the terrain bounds
+uniform vec3 posOffset; // Centre of the terrain bounds
 
-in vec4 vPosition;
-in vec3 vNormal;
+// Quantized position and octahedral-encoded normal (see VertexPacking.h)
+in vec3 vPosition;
+in vec2 vNormal;
 
 out vec3 normal;
 out vec4 position;
 
+vec3 octDecode(vec2 e) {
+    vec3 n = vec3(e.xy, 1.0 - abs(e.x) - abs(e.y));
+    float t = max(-n.z, 0.0);
+    n.x += n.x >= 0.0 ? -t : t;
+    n.y += n.y >= 0.0 ? -t : t;
+    return normalize(n);
+}
+
 void main() {
-    gl_Position = projection * modelView * vPosition;
-    position = vPosition;
-    normal = vNormal;
+    vec4 p = vec4(vPosition * posScale + posOffset, 1.0);
+    gl_Position = projection * modelView * p;
+    position = p;
+    normal = octDecode(vNormal);
 }
@@ -0,0 +1,707 @@
+/************************************************
+ *
+ *       CSCI 4110 Project - Bee Simulation
+ *       Microbenchmarks (Benchmarks project)
+ *
+ *  Times the simulation, terrain and asset hot
+ *  paths without opening a window, prints a table
+ *  with scaling curves and writes the results as
+ *  JSON so builds can be compared over time.
+ *  Exits with 1 if a correctness check run
+ *  alongside the timings fails.
+ *
+ *  usage: Benchmarks [--json file] [--filter text]
+ *                    [--max-bees N] [--min-time s]
+ *
+ ************************************************/
+
+#include <Windows.h>
+#include <gl/glew.h>
+#define GLM_FORCE_RADIANS
+#include <glm/glm.hpp>
+#include <glm/gtc/random.hpp>
+#include "tiny_obj_loader.h"
+#include "Object.h"
+#include "Member.h"
+#include "FlowField.h"
+#include "ClearanceField.h"
+#include "MeshBVH.h"
+#include "NectarStore.h"
+#include "LandMass.h"
+#include "AllocationHook.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct BenchResult {
+    std::string name;      // Benchmark family
+    long long param;       // Swarm size, terrain exponent or 0
+    std::string label;     // Extra label (model name)
+    long long iterations;  // Timed iterations
+    double nsPerOp;        // Wall time per iteration
+    double nsPerItem;      // Wall time per item (bee update, query, grid cell...)
+    double bytesPerOp;     // Heap bytes allocated per iteration
+    double allocsPerOp;    // Heap allocations per iteration
+};
+
+struct BenchOptions {
+    std::string jsonPath = "benchmarks.json";
+    std::string filter;
+    long long maxBees = 100000;
+    double minTime = 0.25; // Seconds per benchmark
+};
+
+// Silences std::cout for its lifetime (fractleGen logs every call)
+class QuietCout {
+private:
+    std::streambuf* saved;
+    std::ostringstream sink;
+
+public:
+    QuietCout() : saved(std::cout.rdbuf(sink.rdbuf())) {}
+    ~QuietCout() { std::cout.rdbuf(saved); }
+};
+
+// Report stream, bound to the real stdout before any QuietCout swaps it
+static std::ostream& out() {
+    static std::ostream stream(std::cout.rdbuf());
+    return stream;
+}
+
+static std::vector<BenchResult> results;
+static BenchOptions options;
+static int failedChecks = 0; // Correctness checks run alongside the timings that failed
+
+static bool selected(const std::string& name) {
+    return options.filter.empty() || name.find(options.filter) != std::string::npos;
+}
+
+// Run `op` until minTime has elapsed (at least once) and record the result
+template <typename F>
+static void runBench(const std::string& name, long long param, const std::string& label, long long itemsPerOp, F&& op) {
+    op(); // Warm-up, also fills any lazily built caches
+
+    unsigned long long allocsBefore = allocations().count.load();
+    unsigned long long bytesBefore = allocations().bytes.load();
+    auto start = std::chrono::steady_clock::now();
+    long long iterations = 0;
+    double elapsed = 0.0;
+    do {
+        op();
+        iterations++;
+        elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    } while (elapsed < options.minTime);
+
+    BenchResult r;
+    r.name = name;
+    r.param = param;
+    r.label = label;
+    r.iterations = iterations;
+    r.nsPerOp = elapsed * 1e9 / iterations;
+    r.nsPerItem = r.nsPerOp / (itemsPerOp > 0 ? itemsPerOp : 1);
+    r.bytesPerOp = double(allocations().bytes.load() - bytesBefore) / iterations;
+    r.allocsPerOp = double(allocations().count.load() - allocsBefore) / iterations;
+    results.push_back(r);
+
+    out() << std::left << std::setw(34) << (label.empty() ? name : name + "/" + label)
+        << std::right << std::setw(9) << param
+        << std::setw(10) << iterations
+        << std::setw(16) << std::fixed << std::setprecision(1) << r.nsPerOp
+        << std::setw(14) << r.nsPerItem
+        << std::setw(14) << std::setprecision(0) << r.bytesPerOp
+        << std::setw(10) << std::setprecision(1) << r.allocsPerOp << std::endl;
+}
+
+// Problem size used for scaling curves: bee count, or grid cells for terrain exponents
+static double problemSize(const BenchResult& r) {
+    if (r.name.compare(0, 10, "LandMass::") == 0) {
+        double side = std::pow(2.0, (double)r.param) + 1.0;
+        return side * side;
+    }
+    return (double)r.param;
+}
+
+// Print how ns/item grows between consecutive sizes of one family (size^k)
+static void printScaling(const std::string& name) {
+    const BenchResult* prev = nullptr;
+    for (const auto& r : results) {
+        if (r.name != name) continue;
+        if (prev != nullptr && problemSize(*prev) > 0 && problemSize(r) > problemSize(*prev) && prev->nsPerItem > 0) {
+            double k = std::log(r.nsPerItem / prev->nsPerItem) / std::log(problemSize(r) / problemSize(*prev));
+            out() << "    " << name << " " << prev->param << " -> " << r.param
+                << ": ns/item x" << std::setprecision(2) << r.nsPerItem / prev->nsPerItem
+                << " (size^" << k << ")" << std::endl;
+        }
+        prev = &r;
+    }
+}
+
+static std::vector<long long> beeSizes() {
+    std::vector<long long> sizes;
+    for (long long n : { 25LL, 100LL, 1000LL, 10000LL, 100000LL }) {
+        if (n <= options.maxBees) sizes.push_back(n);
+    }
+    return sizes;
+}
+
+// Swarm spread over the terrain, as it is after the colony has dispersed
+static std::vector<std::shared_ptr<Member>> makeSwarm(long long count, const BoundBox& bounds) {
+    std::vector<std::shared_ptr<Member>> swarm;
+    swarm.reserve(count);
+    for (long long i = 0; i < count; i++) {
+        glm::vec3 p = glm::linearRand(bounds.min + glm::vec3(1.0f), bounds.max - glm::vec3(1.0f));
+        swarm.emplace_back(std::make_shared<Member>("bee", 0, glm::vec3(1.0f, 0.843f, 0.0f), p));
+    }
+    return swarm;
+}
+
+static std::vector<glm::vec3> makeFlowers(int count, const BoundBox& bounds, LandMass& land) {
+    std::vector<glm::vec3> flowerPts;
+    for (int i = 0; i < count; i++) {
+        glm::vec3 fp = glm::linearRand(bounds.min + glm::vec3(1.0f), bounds.max - glm::vec3(1.0f));
+        fp.y = land.getHeight(fp.x, fp.z) + 0.5f;
+        flowerPts.push_back(fp);
+    }
+    return flowerPts;
+}
+
+// Morton quantization of the flight volume, as Simulation sets it up
+static MortonGrid swarmGrid(const BoundBox& bounds) {
+    return MortonGrid(bounds.min, bounds.max);
+}
+
+// Member::move + update. Large swarms update a strided sample of bees per
+// iteration (the per-bee cost is what is reported) so 100k stays tractable.
+// The snapshot is built once, outside the timed op: its cost covers the whole
+// swarm, not the sample, and SwarmIndex::build times it on its own.
+static void benchMove(LandMass& land) {
+    if (!selected("Member::move")) return;
+    BoundBox bounds = land.getBounds();
+    std::vector<glm::vec3> flowerPts = makeFlowers(50, bounds, land);
+    FlowField field(bounds, 2.0f, 2.0f * Member::senseRadius()); // As Simulation sets it up
+    field.setHome(glm::vec3(0.0f, land.getHeight(0.0f, 0.0f) + 2.0f, 0.0f), land, 4.0f);
+    field.setFlowers(flowerPts);
+    ClearanceField terrain(land, bounds, std::max(1.0f, (land.getGridSize() - 1) / 128.0f));
+    auto hiveBVH = Object::loadBVH("hive");
+    glm::vec3 hiveLoc(0.0f, land.getHeight(0.0f, 0.0f) + 2.0f, 0.0f);
+    PlacedMesh hive(hiveBVH.get(), glm::scale(glm::translate(glm::mat4(1.0f), hiveLoc), glm::vec3(2.5f))); // Smallest hive
+
+    for (long long n : beeSizes()) {
+        auto swarm = makeSwarm(n, bounds);
+        long long sample = n < 2048 ? n : 2048;
+        long long stride = n / sample;
+        FrameArena arena;
+        MortonOrder order;
+        SwarmIndex team;
+        team.build(swarm, swarmGrid(bounds), order, arena);
+        runBench("Member::move", n, "", sample, [&]() {
+            for (long long i = 0; i < sample; i++) {
+                Member& bee = *swarm[team.ids[i * stride]];
+                glm::vec3 p = bee.getPosition();
+                FlowField::NearestFlower flower = field.nearestFlower(p); // Sensed through the terrain, as Simulation does
+                bool inSight = bee.isReturningHome() || !flower.found || glm::length(flower.position - p) >= Member::senseRadius()
+                    || land.lineOfSight(p, flower.position);
+                if (bee.move(0.1f, team, field, inSight, terrain, hive, bounds)) {
+                    bee.collect(); // Unlimited nectar
+                }
+                bee.settle(p, land);
+                bee.update();
+            }
+        });
+    }
+    printScaling("Member::move");
+}
+
+// Neighbor queries against the Morton-sorted index, issued in Morton order as
+// Simulation::tick does, and in birth order for comparison. The same queries
+// either way; Morton order only changes how often consecutive ones share cells.
+static void benchTeamAvg(LandMass& land) {
+    if (!selected("Member::teamAvg")) return;
+    BoundBox bounds = land.getBounds();
+
+    for (const char* queryOrder : { "morton", "birth" }) {
+        bool morton = !strcmp(queryOrder, "morton");
+        std::string name = morton ? "Member::teamAvg" : "Member::teamAvg (birth order)";
+        for (long long n : beeSizes()) {
+            auto swarm = makeSwarm(n, bounds);
+            FrameArena arena;
+            MortonOrder order;
+            SwarmIndex team;
+            team.build(swarm, swarmGrid(bounds), order, arena);
+            long long sample = n < 4096 ? n : 4096;
+            long long stride = n / sample;
+            volatile float sink = 0.0f;
+            runBench(name, n, "", sample, [&]() {
+                for (long long i = 0; i < sample; i++) {
+                    size_t bee = morton ? team.ids[i * stride] : (size_t)(i * stride);
+                    auto avg = swarm[bee]->teamAvg(team, 15.0f);
+                    sink = sink + avg.first.x;
+                }
+            });
+        }
+        printScaling(name);
+    }
+}
+
+// Cohesion sums at each opening angle against the exact ones, on a swarm packed
+// into a ball around the hive so density (neighbors per query) grows with the
+// bee count. Prints the error of the averages Member::teamAvg derives from them.
+static void benchCohesion(LandMass& land) {
+    if (!selected("SwarmIndex::sumNear")) return;
+    BoundBox bounds = land.getBounds();
+    glm::vec3 hive(0.0f, (bounds.min.y + bounds.max.y) * 0.5f, 0.0f);
+    const float radius = 15.0f; // Member::move's swarm radius
+
+    for (float theta : { 0.0f, 0.25f, 0.5f, 1.0f }) {
+        std::ostringstream name;
+        name << "SwarmIndex::sumNear theta=" << theta;
+        for (long long n : beeSizes()) {
+            std::vector<std::shared_ptr<Member>> swarm;
+            swarm.reserve(n);
+            for (long long i = 0; i < n; i++) {
+                swarm.emplace_back(std::make_shared<Member>("bee", 0, glm::vec3(1.0f, 0.843f, 0.0f), hive + glm::ballRand(30.0f)));
+                swarm.back()->setDirection(glm::ballRand(1.0f) + glm::vec3(0.5f, 0.0f, 0.0f));
+            }
+            FrameArena arena;
+            MortonOrder order;
+            SwarmIndex team;
+            team.build(swarm, swarmGrid(bounds), order, arena);
+            long long sample = n < 1024 ? n : 1024;
+            long long stride = n / sample;
+
+            double posError = 0.0;
+            double maxPosError = 0.0;
+            double dirError = 0.0;
+            for (long long i = 0; i < sample; i++) {
+                glm::vec3 p = team.pos[i * stride];
+                team.theta = 0.0f;
+                SwarmSums exact = team.sumNear(p, radius);
+                team.theta = theta;
+                SwarmSums approx = team.sumNear(p, radius);
+                double e = glm::length(approx.pos / approx.count - exact.pos / exact.count);
+                posError += e;
+                maxPosError = e > maxPosError ? e : maxPosError;
+                glm::vec3 exactDir = exact.dir / exact.count;
+                dirError += glm::length(approx.dir / approx.count - exactDir) / glm::length(exactDir);
+            }
+
+            volatile float sink = 0.0f;
+            runBench(name.str(), n, "", sample, [&]() {
+                for (long long i = 0; i < sample; i++) {
+                    sink = sink + team.sumNear(team.pos[i * stride], radius).count;
+                }
+            });
+            out() << "    error vs exact: centroid " << std::setprecision(3) << posError / sample
+                << " mean, " << maxPosError << " max (units); direction "
+                << std::setprecision(2) << 100.0 * dirError / sample << "%" << std::endl;
+        }
+        printScaling(name.str());
+    }
+}
+
+// Snapshot and Morton sort of the swarm. "steady" re-sorts an order that is
+// already sorted, as every tick does; "cold" starts over, as after a restore.
+static void benchSwarmIndex(LandMass& land) {
+    if (!selected("SwarmIndex::build")) return;
+    BoundBox bounds = land.getBounds();
+
+    for (long long n : beeSizes()) {
+        auto swarm = makeSwarm(n, bounds);
+        FrameArena arena;
+        MortonOrder order;
+        runBench("SwarmIndex::build", n, "steady", n, [&]() {
+            SwarmIndex team;
+            team.build(swarm, swarmGrid(bounds), order, arena);
+            arena.reset();
+        });
+        runBench("SwarmIndex::build", n, "cold", n, [&]() {
+            MortonOrder fresh;
+            fresh.reserve(swarm.size());
+            SwarmIndex team;
+            team.build(swarm, swarmGrid(bounds), fresh, arena);
+            arena.reset();
+        });
+    }
+}
+
+// Rounds of `n` claims on `flowerCount` flowers made from `threads` threads,
+// each taking every threads-th bee in reverse order, against the same rounds
+// made serially in order. Returns the rounds whose winners, loads or lost
+// claims differed; NectarStore promises none.
+static int checkNectarThreads(long long n, int flowerCount, int threads, int rounds) {
+    NectarStore serial(3.0f, 5.0f);
+    NectarStore concurrent(3.0f, 5.0f);
+    for (int f = 0; f < flowerCount; f++) {
+        serial.bloom();
+        concurrent.bloom();
+    }
+    std::vector<uint32_t> target((size_t)n);
+    std::vector<uint8_t> serialWon((size_t)n);
+    std::vector<uint8_t> concurrentWon((size_t)n);
+    int differing = 0;
+    for (int round = 0; round < rounds; round++) {
+        for (auto& t : target) t = (uint32_t)(std::rand() % flowerCount);
+        auto priority = [&](long long b) { return (uint32_t)((b + round) % n); }; // As Simulation::claimPriority
+
+        for (long long b = 0; b < n; b++) serial.reserve(target[b], priority(b));
+        for (long long b = 0; b < n; b++) serialWon[b] = serial.collect(target[b], priority(b)) ? 1 : 0;
+        long long serialLost = serial.endTick();
+
+        std::vector<std::thread> workers;
+        for (int t = 0; t < threads; t++) {
+            workers.emplace_back([&, t]() {
+                for (long long b = n - 1 - t; b >= 0; b -= threads) concurrent.reserve(target[b], priority(b));
+            });
+        }
+        for (auto& w : workers) w.join();
+        workers.clear();
+        for (int t = 0; t < threads; t++) {
+            workers.emplace_back([&, t]() {
+                for (long long b = n - 1 - t; b >= 0; b -= threads) concurrentWon[b] = concurrent.collect(target[b], priority(b)) ? 1 : 0;
+            });
+        }
+        for (auto& w : workers) w.join();
+        long long concurrentLost = concurrent.endTick();
+
+        bool same = serialWon == concurrentWon && serialLost == concurrentLost;
+        for (int f = 0; f < flowerCount && same; f++) {
+            same = serial.nectar(f) == concurrent.nectar(f) && serial.contended(f) == concurrent.contended(f);
+        }
+        differing += same ? 0 : 1;
+        serial.refill(1.0f);
+        concurrent.refill(1.0f);
+    }
+    return differing;
+}
+
+// One tick of nectar claims: every bee reserves, collects and the tick ends,
+// spread over a meadow of flowers and all on a single flower. Each size also
+// checks that claims made from several threads settle as serial ones do.
+static void benchNectar() {
+    if (!selected("NectarStore")) return;
+    const int meadows[] = { 50, 1 };
+    for (long long n : beeSizes()) {
+        for (int flowerCount : meadows) {
+            NectarStore nectar(3.0f, 5.0f);
+            for (int f = 0; f < flowerCount; f++) nectar.bloom();
+            std::vector<uint32_t> target((size_t)n);
+            for (auto& t : target) t = (uint32_t)(std::rand() % flowerCount);
+            std::ostringstream label;
+            label << flowerCount << (flowerCount == 1 ? " flower" : " flowers");
+            volatile int sink = 0;
+            runBench("NectarStore::claim", n, label.str(), n, [&]() {
+                for (long long b = 0; b < n; b++) nectar.reserve(target[b], (uint32_t)b);
+                int won = 0;
+                for (long long b = 0; b < n; b++) won += nectar.collect(target[b], (uint32_t)b) ? 1 : 0;
+                nectar.endTick();
+                nectar.refill(1.0f);
+                sink = won;
+            });
+            int threads = std::max(2, std::min(8, (int)std::thread::hardware_concurrency()));
+            int rounds = n <= 1000 ? 200 : 20;
+            int differing = checkNectarThreads(n, flowerCount, threads, rounds);
+            failedChecks += differing > 0 ? 1 : 0;
+            out() << "    " << threads << " threads vs serial: " << differing << " of " << rounds << " rounds differ"
+                << (differing > 0 ? " (FAILED)" : "") << std::endl;
+        }
+    }
+}
+
+static void benchTerrain() {
+    for (int n = 4; n <= 10; n++) {
+        std::unique_ptr<LandMass> landPtr;
+        {
+            QuietCout quiet;
+            landPtr.reset(new LandMass(n));
+        }
+        LandMass& land = *landPtr;
+        land.discardMeshData();
+        int gridSize = land.getGridSize();
+
+        if (selected("LandMass::fractleGen")) {
+            std::unique_ptr<QuietCout> quiet(new QuietCout());
+            runBench("LandMass::fractleGen", n, "", (long long)gridSize * gridSize, [&]() {
+                auto grid = land.fractleGen(gridSize);
+            });
+            quiet.reset();
+        }
+
+        if (selected("LandMass::getHeight")) {
+            BoundBox bounds = land.getBounds();
+            std::vector<glm::vec2> queries(4096);
+            for (auto& q : queries) {
+                glm::vec3 p = glm::linearRand(bounds.min, bounds.max);
+                q = glm::vec2(p.x, p.z);
+            }
+            volatile float sink = 0.0f;
+            runBench("LandMass::getHeight", n, "", (long long)queries.size(), [&]() {
+                float sum = 0.0f;
+                for (const auto& q : queries) {
+                    sum += land.getHeight(q.x, q.y);
+                }
+                sink = sum;
+            });
+        }
+
+        if (selected("LandMass::getHeights")) {
+            BoundBox bounds = land.getBounds();
+            std::vector<glm::vec2> queries(4096);
+            for (auto& q : queries) {
+                glm::vec3 p = glm::linearRand(bounds.min, bounds.max);
+                q = glm::vec2(p.x, p.z);
+            }
+            for (size_t i = 0; i < queries.size(); i += 16) {
+                queries[i] *= 1.25f; // Some points off the grid, for the masked lanes
+            }
+            std::vector<float> heights(queries.size());
+#if defined(__AVX2__)
+            const char* path = "avx2";
+#else
+            const char* path = "scalar";
+#endif
+            volatile float sink = 0.0f;
+            runBench("LandMass::getHeights", n, path, (long long)queries.size(), [&]() {
+                land.getHeights(queries, heights.data());
+                sink = heights[0];
+            });
+            int differing = 0;
+            for (size_t i = 0; i < queries.size(); i++) {
+                differing += heights[i] == land.getHeight(queries[i].x, queries[i].y) ? 0 : 1;
+            }
+            failedChecks += differing > 0 ? 1 : 0;
+            out() << "    vs getHeight: " << differing << " of " << queries.size() << " heights differ"
+                << (differing > 0 ? " (FAILED)" : "") << std::endl;
+        }
+
+        if (selected("LandMass::sweep")) {
+            // Bee steps at the default tick and at fast-forward lengths, from
+            // random points in the flight volume
+            BoundBox bounds = land.getBounds();
+            const float steps[] = { 0.5f, 5.0f, 50.0f };
+            for (float step : steps) {
+                std::vector<glm::vec3> from(4096);
+                std::vector<glm::vec3> to(from.size());
+                for (size_t i = 0; i < from.size(); i++) {
+                    from[i] = glm::linearRand(bounds.min, bounds.max);
+                    to[i] = from[i] + glm::normalize(glm::linearRand(glm::vec3(-1.0f), glm::vec3(1.0f))) * step;
+                }
+                std::ostringstream label;
+                label << "step " << step;
+                volatile int sink = 0;
+                runBench("LandMass::sweep", n, label.str(), (long long)from.size(), [&]() {
+                    int hits = 0;
+                    LandMass::GroundHit hit;
+                    for (size_t i = 0; i < from.size(); i++) {
+                        hits += land.sweep(from[i], to[i], hit) ? 1 : 0;
+                    }
+                    sink = hits;
+                });
+            }
+        }
+
+        if (selected("LandMass::lineOfSight")) {
+            // Sight lines from a few units over the ground to a flower at the
+            // bee's sensing range and across the map, by the pyramid and by
+            // marching quarter-cell steps
+            BoundBox bounds = land.getBounds();
+            const float lengths[] = { Member::senseRadius(), (float)gridSize };
+            for (float length : lengths) {
+                std::vector<glm::vec3> from(4096);
+                std::vector<glm::vec3> to(from.size());
+                for (size_t i = 0; i < from.size(); i++) {
+                    from[i] = glm::linearRand(bounds.min, bounds.max);
+                    from[i].y = land.getHeight(from[i].x, from[i].z) + glm::linearRand(0.5f, 5.0f);
+                    float heading = glm::linearRand(0.0f, 6.2831853f);
+                    to[i] = from[i] + glm::vec3(std::cos(heading), 0.0f, std::sin(heading)) * length;
+                    to[i].y = land.getHeight(to[i].x, to[i].z) + 0.5f;
+                }
+                std::vector<uint8_t> visible(from.size());
+                std::ostringstream label;
+                label << "length " << length;
+                volatile int sink = 0;
+                runBench("LandMass::lineOfSight", n, label.str() + " max-mip", (long long)from.size(), [&]() {
+                    land.lineOfSight(from, to, visible.data());
+                    sink = visible[0];
+                });
+                runBench("LandMass::lineOfSight", n, label.str() + " march", (long long)from.size(), [&]() {
+                    int seen = 0;
+                    for (size_t i = 0; i < from.size(); i++) {
+                        int steps = (int)(length / 0.25f) + 1;
+                        bool clear = true;
+                        for (int s = 0; s <= steps && clear; s++) {
+                            glm::vec3 q = from[i] + (to[i] - from[i]) * ((float)s / steps);
+                            clear = q.y >= land.getHeight(q.x, q.z);
+                        }
+                        seen += clear ? 1 : 0;
+                    }
+                    sink = seen;
+                });
+            }
+        }
+
+        if (selected("ClearanceField")) {
+            BoundBox bounds = land.getBounds();
+            float cell = std::max(1.0f, (gridSize - 1) / 128.0f); // As Simulation sets it up
+            ClearanceField terrain(land, bounds, cell);
+            runBench("ClearanceField::build", n, "", (long long)gridSize * gridSize, [&]() {
+                terrain.build(land);
+            });
+            std::vector<glm::vec3> queries(4096);
+            for (auto& q : queries) q = glm::linearRand(bounds.min, bounds.max);
+            volatile float sink = 0.0f;
+            runBench("ClearanceField::sample", n, "", (long long)queries.size(), [&]() {
+                float sum = 0.0f;
+                for (const auto& q : queries) {
+                    sum += terrain.sample(q).distance;
+                }
+                sink = sum;
+            });
+        }
+    }
+    printScaling("LandMass::fractleGen");
+    printScaling("LandMass::getHeight");
+    printScaling("LandMass::getHeights");
+    printScaling("ClearanceField::build");
+    printScaling("ClearanceField::sample");
+}
+
+static void benchAssets() {
+    const char* models[] = { "bee", "flower_platform", "hive", "ground" };
+    for (const char* model : models) {
+        if (selected("tinyobj::LoadObj")) {
+            std::string objPath = std::string("src/") + model + ".obj";
+            runBench("tinyobj::LoadObj", 0, model, 1, [&]() {
+                std::vector<tinyobj::shape_t> shapes;
+                std::vector<tinyobj::material_t> materials;
+                std::string err = tinyobj::LoadObj(shapes, materials, objPath.c_str(), 0);
+                if (!err.empty()) std::cerr << err << std::endl;
+            });
+        }
+        if (selected("Object::decodeMesh")) {
+            runBench("Object::decodeMesh", 0, model, 1, [&]() {
+                auto mesh = Object::decodeMesh(model);
+            });
+        }
+        if (selected("MeshBVH")) {
+            auto mesh = Object::loadMesh(model);
+            if (!mesh) continue;
+            long long triangles = (long long)mesh->indices.size() / 3;
+            runBench("MeshBVH::build", triangles, model, triangles, [&]() {
+                MeshBVH bvh(mesh->vertices, mesh->indices);
+            });
+
+            // Points and rays around the model, out to twice its extent
+            MeshBVH bvh(mesh->vertices, mesh->indices);
+            glm::vec3 lower(INFINITY), upper(-INFINITY);
+            for (size_t i = 0; i + 2 < mesh->vertices.size(); i += 3) {
+                glm::vec3 v(mesh->vertices[i], mesh->vertices[i + 1], mesh->vertices[i + 2]);
+                lower = glm::min(lower, v);
+                upper = glm::max(upper, v);
+            }
+            glm::vec3 middle = (lower + upper) * 0.5f;
+            std::vector<glm::vec3> points(4096);
+            std::vector<glm::vec3> headings(points.size());
+            for (size_t i = 0; i < points.size(); i++) {
+                points[i] = glm::linearRand(middle + (lower - middle) * 2.0f, middle + (upper - middle) * 2.0f);
+                headings[i] = glm::normalize(glm::linearRand(glm::vec3(-1.0f), glm::vec3(1.0f)));
+            }
+            volatile float sink = 0.0f;
+            runBench("MeshBVH::closestPoint", triangles, model, (long long)points.size(), [&]() {
+                float sum = 0.0f;
+                glm::vec3 nearest;
+                for (const auto& q : points) {
+                    if (bvh.closestPoint(q, INFINITY, nearest)) sum += nearest.x;
+                }
+                sink = sum;
+            });
+            runBench("MeshBVH::raycast", triangles, model, (long long)points.size(), [&]() {
+                float sum = 0.0f;
+                float hit;
+                for (size_t i = 0; i < points.size(); i++) {
+                    if (bvh.raycast(points[i], headings[i], INFINITY, hit)) sum += hit;
+                }
+                sink = sum;
+            });
+        }
+    }
+}
+
+static void writeJson(const std::string& path) {
+    FILE* fid = fopen(path.c_str(), "w");
+    if (fid == NULL) {
+        std::cerr << "can't open " << path << std::endl;
+        return;
+    }
+    char date[32];
+    std::time_t now = std::time(0);
+    std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S", std::localtime(&now));
+
+    fprintf(fid, "{\n  \"context\": {\"date\": \"%s\", \"build\": \"%s\"},\n  \"benchmarks\": [\n", date,
+#ifdef NDEBUG
+        "release"
+#else
+        "debug"
+#endif
+    );
+    for (size_t i = 0; i < results.size(); i++) {
+        const BenchResult& r = results[i];
+        fprintf(fid, "    {\"name\": \"%s\", \"label\": \"%s\", \"param\": %lld, \"iterations\": %lld, "
+            "\"ns_per_op\": %.1f, \"ns_per_item\": %.3f, \"bytes_per_op\": %.1f, \"allocs_per_op\": %.2f}%s\n",
+            r.name.c_str(), r.label.c_str(), r.param, r.iterations, r.nsPerOp, r.nsPerItem,
+            r.bytesPerOp, r.allocsPerOp, i + 1 < results.size() ? "," : "");
+    }
+    fprintf(fid, "  ]\n}\n");
+    fclose(fid);
+    out() << "Wrote " << results.size() << " results to " << path << std::endl;
+}
+
+int main(int argc, char** argv) {
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--json") && i + 1 < argc) options.jsonPath = argv[++i];
+        else if (!strcmp(argv[i], "--filter") && i + 1 < argc) options.filter = argv[++i];
+        else if (!strcmp(argv[i], "--max-bees") && i + 1 < argc) options.maxBees = atoll(argv[++i]);
+        else if (!strcmp(argv[i], "--min-time") && i + 1 < argc) options.minTime = atof(argv[++i]);
+        else {
+            fprintf(stderr, "usage: Benchmarks [--json file] [--filter text] [--max-bees N] [--min-time s]\n");
+            return 1;
+        }
+    }
+
+    std::srand(1234); // Same swarm and flower layout on every run
+    Object::headless() = true; // No GL context, simulation only
+
+    out() << std::left << std::setw(34) << "benchmark" << std::right << std::setw(9) << "param"
+        << std::setw(10) << "iters" << std::setw(16) << "ns/op" << std::setw(14) << "ns/item"
+        << std::setw(14) << "bytes/op" << std::setw(10) << "allocs" << std::endl;
+
+    std::unique_ptr<QuietCout> quiet(new QuietCout());
+    LandMass land(8); // Same terrain size as the simulation
+    land.discardMeshData();
+    quiet.reset();
+    benchMove(land);
+    benchTeamAvg(land);
+    benchSwarmIndex(land);
+    benchCohesion(land);
+    benchNectar();
+    benchTerrain();
+    benchAssets();
+
+    writeJson(options.jsonPath);
+    if (failedChecks > 0) {
+        std::cerr << failedChecks << " correctness checks failed" << std::endl;
+        return 1;
+    }
+    return 0;
+}
\ No newline at end of file
@@ -0,0 +1,160 @@
+/************************************************
+ *
+ *       embed_meshes - build-time asset baker
+ *
+ *  Reads each named .obj with tinyobj (the same
+ *  path Object uses at runtime) and writes a header
+ *  of aligned constexpr arrays. Names with an
+ *  extension (shaders, the height map) are baked
+ *  as text, so EMBED_MESHES builds never touch the
+ *  file system for their assets.
+ *
+ *  usage: embed_meshes <srcDir> <outHeader> <name>...
+ *
+ ************************************************/
+
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "tiny_obj_loader.h"
+
+// Write a constexpr array, 8 values per line
+template <typename T>
+static void writeArray(FILE* out, const char* type, const std::string& name, const std::vector<T>& values, const char* format) {
+    fprintf(out, "alignas(16) constexpr %s %s[] = {", type, name.c_str());
+    if (values.empty()) {
+        fprintf(out, " 0 "); // Zero-length arrays are not allowed, the count stays 0
+    }
+    for (size_t i = 0; i < values.size(); i++) {
+        if (i % 8 == 0) fprintf(out, "\n    ");
+        fprintf(out, format, values[i]);
+        fprintf(out, ",");
+    }
+    fprintf(out, "\n};\n");
+}
+
+int main(int argc, char** argv) {
+    if (argc < 4) {
+        fprintf(stderr, "usage: embed_meshes <srcDir> <outHeader> <name>...\n");
+        return 1;
+    }
+
+    std::string srcDir = argv[1];
+    std::vector<std::string> names(argv + 3, argv + argc);
+
+    FILE* out = fopen(argv[2], "w");
+    if (out == NULL) {
+        fprintf(stderr, "can't open output file: %s\n", argv[2]);
+        return 1;
+    }
+
+    fprintf(out, "// Generated by embed_meshes from the .obj models - do not edit\n");
+    fprintf(out, "#pragma once\n\n");
+    fprintf(out, "#include <cstring>\n\n");
+    fprintf(out, "namespace embedded {\n\n");
+    fprintf(out, "struct EmbeddedMesh {\n");
+    fprintf(out, "    const char* name;\n");
+    fprintf(out, "    const float* vertices;\n");
+    fprintf(out, "    int vertexCount;\n");
+    fprintf(out, "    const float* normals;\n");
+    fprintf(out, "    int normalCount;\n");
+    fprintf(out, "    const unsigned int* indices;\n");
+    fprintf(out, "    int indexCount;\n");
+    fprintf(out, "};\n\n");
+    fprintf(out, "struct EmbeddedFile {\n");
+    fprintf(out, "    const char* name;\n");
+    fprintf(out, "    const char* text;\n");
+    fprintf(out, "    int length;\n");
+    fprintf(out, "};\n\n");
+
+    std::vector<std::string> entries;
+    std::vector<std::string> fileEntries;
+    for (const auto& name : names) {
+        if (name.find('.') != std::string::npos) {
+            // Text asset, kept as a null-terminated char array
+            std::string path = srcDir + "/" + name;
+            FILE* in = fopen(path.c_str(), "rb");
+            if (in == NULL) {
+                fprintf(stderr, "failed to open %s\n", path.c_str());
+                fclose(out);
+                remove(argv[2]);
+                return 1;
+            }
+            std::vector<int> text;
+            int c;
+            while ((c = fgetc(in)) != EOF) text.push_back(c);
+            fclose(in);
+            int length = (int)text.size();
+            text.push_back(0);
+
+            std::string symbol = name;
+            for (char& ch : symbol) {
+                if (ch == '.' || ch == '-') ch = '_';
+            }
+            writeArray(out, "char", symbol + "_text", text, "%d");
+            fprintf(out, "\n");
+
+            char entry[512];
+            sprintf(entry, "    { \"%s\", %s_text, %d },\n", name.c_str(), symbol.c_str(), length);
+            fileEntries.push_back(entry);
+            continue;
+        }
+
+        std::vector<tinyobj::shape_t> shapes;
+        std::vector<tinyobj::material_t> materials;
+        std::string objPath = srcDir + "/" + name + ".obj";
+
+        std::string err = tinyobj::LoadObj(shapes, materials, objPath.c_str(), 0);
+        if (!err.empty() || shapes.empty()) {
+            fprintf(stderr, "failed to load %s: %s\n", objPath.c_str(), err.c_str());
+            fclose(out);
+            remove(argv[2]);
+            return 1;
+        }
+
+        const tinyobj::mesh_t& mesh = shapes[0].mesh;
+        writeArray(out, "float", name + "_vertices", mesh.positions, "%.8ef");
+        writeArray(out, "float", name + "_normals", mesh.normals, "%.8ef");
+        writeArray(out, "unsigned int", name + "_indices", mesh.indices, "%uu");
+        fprintf(out, "\n");
+
+        char entry[512];
+        sprintf(entry, "    { \"%s\", %s_vertices, %d, %s_normals, %d, %s_indices, %d },\n",
+            name.c_str(), name.c_str(), (int)mesh.positions.size(), name.c_str(), (int)mesh.normals.size(),
+            name.c_str(), (int)mesh.indices.size());
+        entries.push_back(entry);
+    }
+
+    fprintf(out, "constexpr EmbeddedMesh meshes[] = {\n");
+    for (const auto& e : entries) {
+        fprintf(out, "%s", e.c_str());
+    }
+    fprintf(out, "};\n\n");
+    fprintf(out, "constexpr int meshCount = %d;\n\n", (int)entries.size());
+
+    fprintf(out, "constexpr EmbeddedFile files[] = {\n");
+    for (const auto& e : fileEntries) {
+        fprintf(out, "%s", e.c_str());
+    }
+    if (fileEntries.empty()) {
+        fprintf(out, "    { \"\", \"\", 0 },\n"); // Zero-length arrays are not allowed, the count stays 0
+    }
+    fprintf(out, "};\n\n");
+    fprintf(out, "constexpr int fileCount = %d;\n\n", (int)fileEntries.size());
+
+    // Lookup by file name; any directory in `path` is ignored
+    fprintf(out, "inline const EmbeddedFile* findFile(const char* path) {\n");
+    fprintf(out, "    const char* name = path;\n");
+    fprintf(out, "    for (const char* c = path; *c; c++) {\n");
+    fprintf(out, "        if (*c == '/' || *c == '\\\\') name = c + 1;\n");
+    fprintf(out, "    }\n");
+    fprintf(out, "    for (int i = 0; i < fileCount; i++) {\n");
+    fprintf(out, "        if (strcmp(files[i].name, name) == 0) return &files[i];\n");
+    fprintf(out, "    }\n");
+    fprintf(out, "    return nullptr;\n");
+    fprintf(out, "}\n\n");
+    fprintf(out, "}\n");
+
+    fclose(out);
+    return 0;
+}
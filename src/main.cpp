@@ -24,9 +24,19 @@
 #include "Member.h"
 #include "LandMass.h"
 #include "EcoObj.h"
+#include "Simulation.h"
+#include "Checkpoint.h"
+#include "Trajectory.h"
+#include "AllocationHook.h"
+#include "StartupPipeline.h"
+#include "Profiler.h"
+#include "Telemetry.h"
 #include <vector>
+#include <memory>
 #include <chrono>
 #include <thread>
+#include <string>
+#include <cstring>
 
 // Global variables for shader program, object data, and other parameters
 GLuint program;      // Shader program ID
@@ -46,6 +56,9 @@ double r;
 // Update delta for animation
 double delta = 0.1;
 
+// Simulated seconds per tick, the 20 Hz the swap interval gives on a 60 Hz display
+const double tickSeconds = 0.05;
+
 // Camera position
 float cx, cy, cz;
 
@@ -53,6 +66,11 @@ float cx, cy, cz;
 glm::mat4 view;       // View matrix
 glm::mat4 projection; // Projection matrix
 
+// Replay playback input, consumed by the render loop
+bool replayPaused = false;   // Space toggles
+int replaySeekTicks = 0;     // Page Up / Page Down step 10 s, Home rewinds
+bool replayRewind = false;
+
 // Function to handle window resizing
 void framebufferSizeCallback(GLFWwindow* window, int w, int h) {
     if (h == 0) h = 1; // Prevent division by zero if height is zero
@@ -74,6 +92,12 @@ static void key_callback(GLFWwindow* window, int key, int scancode, int action,
 
     if (action == GLFW_PRESS || action == GLFW_REPEAT) {
         camera.processKeyboard(key, 0.1); // Process camera movement
+
+        // Trajectory replay controls (ignored when simulating)
+        if (key == GLFW_KEY_SPACE && action == GLFW_PRESS) replayPaused = !replayPaused;
+        if (key == GLFW_KEY_PAGE_UP) replaySeekTicks += 200;
+        if (key == GLFW_KEY_PAGE_DOWN) replaySeekTicks -= 200;
+        if (key == GLFW_KEY_HOME) replayRewind = true;
     }
 }
 
@@ -82,89 +106,185 @@ void error_callback(int error, const char* description) {
     fprintf(stderr, "Error: %s\n", description);
 }
 
-// Function to extract positions and directions from a team of objects
-std::vector<std::vector<glm::vec3>> getTeamLocDir(std::vector<std::shared_ptr<Member>> team) {
-    std::vector<glm::vec3> teamLoc;
-    std::vector<glm::vec3> teamDir;
-    std::vector<std::vector<glm::vec3>> teamLocDir;
-
-    for (const auto& mem : team) {
-        teamLoc.emplace_back(mem->getPosition());   // Get positions
-        teamDir.emplace_back(mem->getDirection()); // Get directions
-    }
-    teamLocDir.emplace_back(teamLoc);
-    teamLocDir.emplace_back(teamDir);
-    return teamLocDir;
-}
-
 int main(int argc, char** argv) {
     auto timer = std::chrono::steady_clock::now(); // Timer for tracking execution
     std::srand(static_cast<unsigned int>(std::time(0)));
     GLFWwindow* window;
 
-    glfwSetErrorCallback(error_callback); // Set error callback
-
-    if (!glfwInit()) { // Initialize GLFW
-        fprintf(stderr, "can't initialize GLFW\n");
+    StartupPipeline startup(timer); // Startup task graph and phase timings
+
+    // Command line options:
+    //   --telemetry <file:path|unix:path> [--telemetry-interval ms]   live stats
+    //   --checkpoint <path> [--checkpoint-interval s]                  periodic snapshots
+    //   --restore <path>                                               resume from a snapshot
+    //   --record <path>                                                record bee trajectories
+    //   --replay <path> [--replay-start tick]                          play a recording, no simulation
+    //   --warp <K>                                                     time-warp: render every Kth tick, 0 = never
+    //   --run-for <seconds>                                            exit after this much simulated time
+    //   --memory-budget <tag=MB,...>                                   terrain, meshes, swarm, ..., total
+    //   --cohesion-theta <t>                                           swarm cohesion accuracy, 0 = exact
+    //   --lod-slices <K> [--lod-max-steers N]                          steer transit bees every Kth tick, cap steering
+    //   --nectar <loads> [--nectar-refill s]                           nectar per flower (0 = no limit), refill time per load
+    std::string telemetryTarget;
+    int telemetryInterval = 1000;
+    std::string checkpointPath;
+    double checkpointInterval = 30.0;
+    std::string restorePath;
+    std::string recordPath;
+    std::string replayPath;
+    long long replayStart = -1;
+    int warp = -1;        // Ticks per rendered frame in time-warp mode, -1 when off
+    double runFor = 0.0;  // Simulated seconds to run, 0 for no limit
+    SimulationConfig simConfig;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--telemetry") && i + 1 < argc) telemetryTarget = argv[++i];
+        else if (!strcmp(argv[i], "--telemetry-interval") && i + 1 < argc) telemetryInterval = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--checkpoint") && i + 1 < argc) checkpointPath = argv[++i];
+        else if (!strcmp(argv[i], "--checkpoint-interval") && i + 1 < argc) checkpointInterval = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--restore") && i + 1 < argc) restorePath = argv[++i];
+        else if (!strcmp(argv[i], "--record") && i + 1 < argc) recordPath = argv[++i];
+        else if (!strcmp(argv[i], "--replay") && i + 1 < argc) replayPath = argv[++i];
+        else if (!strcmp(argv[i], "--replay-start") && i + 1 < argc) replayStart = atoll(argv[++i]);
+        else if (!strcmp(argv[i], "--warp") && i + 1 < argc) warp = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--run-for") && i + 1 < argc) runFor = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--cohesion-theta") && i + 1 < argc) simConfig.cohesionTheta = (float)atof(argv[++i]);
+        else if (!strcmp(argv[i], "--lod-slices") && i + 1 < argc) simConfig.lodSlices = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--lod-max-steers") && i + 1 < argc) simConfig.lodMaxSteers = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--nectar") && i + 1 < argc) simConfig.nectarLoads = (float)atof(argv[++i]);
+        else if (!strcmp(argv[i], "--nectar-refill") && i + 1 < argc) simConfig.nectarRefillSeconds = (float)atof(argv[++i]);
+        else if (!strcmp(argv[i], "--memory-budget") && i + 1 < argc) {
+            if (!parseMemoryBudgets(argv[++i])) {
+                fprintf(stderr, "invalid memory budget: %s\n", argv[i]);
+            }
+        }
     }
-
-    // Create a GLFW window
-    window = glfwCreateWindow(512, 512, "Adv Graphics Project - Bee Sim", NULL, NULL);
-
-    if (!window) {
-        glfwTerminate();
-        exit(EXIT_FAILURE);
+    std::unique_ptr<TelemetryPublisher> publisher;
+    if (!telemetryTarget.empty()) {
+        publisher.reset(new TelemetryPublisher(telemetryTarget, telemetryInterval));
+        if (!publisher->start()) {
+            fprintf(stderr, "invalid telemetry target: %s\n", telemetryTarget.c_str());
+            publisher.reset();
+        }
     }
 
-    // Set callbacks for window resizing and key input
-    glfwSetFramebufferSizeCallback(window, framebufferSizeCallback);
-    glfwSetKeyCallback(window, key_callback);
+    // Initialize variables
+    int n = 8; // Grid size
 
-    glfwMakeContextCurrent(window);
-    GLenum error = glewInit(); // Initialize GLEW
-    if (error != GLEW_OK) {
-        printf("Error starting GLEW: %s\n", glewGetErrorString(error));
-        exit(0);
+    // Lower the terrain resolution until it fits the memory budget. Restored and
+    // replayed terrain must keep the saved size.
+    long long terrainBudget = memoryBudget(memoryTerrain) > 0 ? memoryBudget(memoryTerrain) : memoryBudget(memoryTagCount);
+    if (terrainBudget > 0 && restorePath.empty() && replayPath.empty()) {
+        int wanted = n;
+        while (n > 4 && LandMass::estimateBytes(n) > terrainBudget) n--;
+        if (n != wanted) {
+            std::cout << "Terrain lowered to n=" << n << " (" << LandMass::estimateBytes(n) / (1024 * 1024.0)
+                << " MB) to fit the memory budget" << std::endl;
+        }
     }
 
-    // Load shaders and create shader program
-    GLuint vs = buildShader(GL_VERTEX_SHADER, "src/lab1c.vs");
-    GLuint fs = buildShader(GL_FRAGMENT_SHADER, "src/lab1c.fs");
-    GLuint shaderProgram = buildProgram(vs, fs, 0);
+    // CPU-only startup work runs on worker threads while the window is created
+    std::unique_ptr<LandMass> landPtr;
+    std::unique_ptr<SimulationState> restored; // Snapshot to resume from, if any
+    std::unique_ptr<TrajectoryReader> replay;  // Recording to play back, if any
+    startup.submit(!replayPath.empty() ? "trajectory load" : !restorePath.empty() ? "checkpoint load" : "terrain generation",
+        [&landPtr, &restored, &restorePath, &replay, &replayPath, n]() {
+            if (!replayPath.empty()) {
+                replay.reset(new TrajectoryReader());
+                if (replay->open(replayPath)) {
+                    landPtr.reset(new LandMass(replay->getTerrain().n, replay->getTerrain().heights));
+                    return;
+                }
+                replay.reset(); // Unreadable, simulate instead
+            }
+            if (!restorePath.empty()) {
+                restored.reset(new SimulationState());
+                if (checkpoint::load(restorePath, *restored)) {
+                    landPtr.reset(new LandMass(restored->terrain->n, restored->terrain->heights));
+                    return;
+                }
+                restored.reset(); // Unreadable, start a new colony instead
+            }
+            landPtr.reset(new LandMass(n));
+        },
+        [&landPtr]() { landPtr->upload(); });
+    startup.submit("shader sources", []() {
+        prepareProgram("src/lab1c.vs", "src/lab1c.fs");
+        prepareProgram("src/assign1.vs", "src/assign1.fs");
+    });
+    startup.submit("mesh decode: bee", []() { Object::loadMesh("bee"); });
+    startup.submit("mesh decode: flower_platform", []() { Object::loadMesh("flower_platform"); });
+    startup.submit("mesh decode: hive", []() { Object::loadMesh("hive"); });
+
+    startup.run("window + GL context", [&window]() {
+        glfwSetErrorCallback(error_callback); // Set error callback
+
+        if (!glfwInit()) { // Initialize GLFW
+            fprintf(stderr, "can't initialize GLFW\n");
+        }
 
-    // Initialize variables
-    int n = 8; // Grid size
-    int gridSize = pow(n, 2) + 1;
-    float halfGrid = gridSize / 2;
-    glm::vec3 hiveLoc = glm::vec3(0.0f);
+        // Create a GLFW window
+        window = glfwCreateWindow(512, 512, "Adv Graphics Project - Bee Sim", NULL, NULL);
 
-    // Initialize landmass and other objects
-    LandMass land(n, shaderProgram);
+        if (!window) {
+            glfwTerminate();
+            exit(EXIT_FAILURE);
+        }
 
-    BoundBox bounds = land.getBounds(); // Get land boundaries
-    hiveLoc.y = land.getHeight(hiveLoc.x, hiveLoc.z) + 2;
-    EcoObj hive("hive", shaderProgram, glm::vec3(1.0f, 0.627f, 0.196f), hiveLoc, glm::vec3(0, 0, 1));
+        // Set callbacks for window resizing and key input
+        glfwSetFramebufferSizeCallback(window, framebufferSizeCallback);
+        glfwSetKeyCallback(window, key_callback);
 
-    std::vector<std::shared_ptr<Member>> swarm; // Vector for swarm (bees)
-    std::vector<std::shared_ptr<EcoObj>> flowers; // Vector for flowers
+        glfwMakeContextCurrent(window);
+        GLenum error = glewInit(); // Initialize GLEW
+        if (error != GLEW_OK) {
+            printf("Error starting GLEW: %s\n", glewGetErrorString(error));
+            exit(0);
+        }
+    });
 
-    // Create initial swarm of bees
-    for (int i = 0; i < 25; ++i) {
-        swarm.emplace_back(std::make_shared<Member>("bee", shaderProgram, glm::vec3(1.0f, 0.843f, 0.0f), hiveLoc));
-    }
+    // Load shaders and create shader program
+    GLuint shaderProgram;
+    startup.run("shader program", [&shaderProgram]() {
+        shaderProgram = getProgram("src/lab1c.vs", "src/lab1c.fs");
+    });
+
+    // Upload worker results on this thread as they arrive
+    startup.drain();
+    LandMass& land = *landPtr;
+
+    std::unique_ptr<Simulation> simPtr; // Bees, flowers, hive and the colony rules
+    std::unique_ptr<Object> replayBee;  // One bee model drawn at every recorded position
+
+    startup.run("scene objects", [&]() {
+        if (replay) {
+            // Only the hive and flowers come from the Simulation, nothing is ticked
+            SimulationConfig empty;
+            empty.initialBees = 0;
+            empty.flowerCount = 0;
+            simPtr.reset(new Simulation(land, shaderProgram, empty, nullptr));
+            replayBee.reset(new Object("bee", shaderProgram, glm::vec3(1.0f, 0.843f, 0.0f)));
+            replay->seek(replayStart >= 0 ? (uint32_t)replayStart : replay->firstTick());
+            std::cout << "Replaying ticks " << replay->firstTick() << " to " << replay->lastTick() << std::endl;
+            return;
+        }
+        // Colony events go to the console unless telemetry is publishing them
+        simPtr.reset(new Simulation(land, shaderProgram, simConfig, publisher ? nullptr : &std::cout));
+        if (restored) {
+            simPtr->restore(*restored);
+            std::cout << "Restored " << restored->bees.size() << " bees at tick " << restored->tick << std::endl;
+        }
+    });
+    Simulation& sim = *simPtr;
 
-    std::vector<glm::vec3> flowerPts; // Vector for flower points
-
-    // Generate initial flowers
-    for (int i = 0; i < 50; ++i) {
-        glm::vec3 fp;
-        do{
-            fp = glm::linearRand(bounds.min + glm::vec3(1.0f), bounds.max - glm::vec3(1.0f));
-        } while (glm::length(fp) < 10.0f); // Re-randomize if within 10 units of the origin
-        fp.y = land.getHeight(fp.x, fp.z) + 0.5f;
-        flowerPts.push_back(fp);
-        flowers.emplace_back(std::make_shared<EcoObj>("flower_platform", shaderProgram, glm::vec3(1.0f, 0.4118f, 0.7059f), fp, glm::vec3(0, 0, 1)));
+    std::unique_ptr<Checkpointer> checkpointer; // Background snapshot writer
+    if (!checkpointPath.empty() && !replay) {
+        checkpointer.reset(new Checkpointer(checkpointPath));
+    }
+    std::unique_ptr<TrajectoryRecorder> recorder; // Background trajectory writer
+    if (!recordPath.empty() && !replay) {
+        recorder.reset(new TrajectoryRecorder(recordPath, *sim.capture().terrain, land.getBounds()));
     }
+    trajectory::Frame replayFrame; // Frame on screen during replay
 
     glEnable(GL_DEPTH_TEST); // Enable depth testing
     glClearColor(0.529f, 0.808f, 0.922f, 1.0); // Set clear color
@@ -172,86 +292,143 @@ int main(int argc, char** argv) {
 
     projection = glm::perspective(0.7f, 1.0f, 1.0f, 800.0f); // Set initial projection matrix
 
-    glfwSwapInterval(3); // Limit frame rate
+    glfwSwapInterval(warp >= 0 && !replay ? 0 : 3); // Limit frame rate, unless time-warping
 
-    auto beeTimer = std::chrono::steady_clock::now(); // Timer for bee updates
-    auto flowerTimer = std::chrono::steady_clock::now(); // Timer for flower updates
-
-    int plnCount = 0; // Pollen count
+    double lastCheckpoint = sim.clock;
+    double runStart = sim.clock; // For the time-warp summary
+    auto wallStart = std::chrono::steady_clock::now();
+    bool firstFrame = true; // Report time-to-first-frame once
 
     // Main rendering loop
     while (!glfwWindowShouldClose(window)) {
+        PROFILE_ZONE("frame");
+        AllocationScope frameAllocs; // Heap allocations made by this frame
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT); // Clear buffers
 
         view = camera.getViewMatrix(); // Update view matrix
         projection = glm::perspective(0.7f, 1.0f, 1.0f, 800.0f); // Update projection matrix
 
-        auto currentTime = std::chrono::steady_clock::now(); // Current time
-
-        // Spawn new bee periodically
-        if (std::chrono::duration_cast<std::chrono::seconds>(currentTime - beeTimer).count() >= 60 / std::sqrt(plnCount + 1) && swarm.size() < 200) {
-            swarm.emplace_back(std::make_shared<Member>("bee", shaderProgram, glm::vec3(1.0f, 0.843f, 0.0f), hiveLoc));
-            beeTimer = currentTime;
-            if (swarm.size() == 200) {
-                std::cout << "A New Bee was Born!! Max Beez!!!" << std::endl;
-                std::cout << std::chrono::duration_cast<std::chrono::seconds>(currentTime - timer).count() << std::endl;
+        if (replay) {
+            // Step through the recording instead of simulating
+            PROFILE_ZONE("replay frame");
+            if (replayRewind || replaySeekTicks != 0) {
+                long long target = replayRewind ? replay->firstTick() : (long long)replayFrame.tick + replaySeekTicks;
+                replay->seek(target < 0 ? 0 : (uint32_t)target);
+                replayRewind = false;
+                replaySeekTicks = 0;
+                replayPaused = false;
             }
-            else {
-                std::cout << "A New Bee was Born!!" << std::endl;
+            if (!replayPaused && !replay->next(replayFrame)) {
+                replayPaused = true; // Hold the last frame at the end
             }
+            sim.showReplay(replayFrame.tick, replayFrame.pollen, replayFrame.flowers);
         }
+        else {
+            // Spawn bees, cycle flowers, move the swarm and grow the hive. One tick
+            // per frame normally; time-warp runs K ticks per rendered frame, or
+            // ticks for 50 ms between event polls when nothing is rendered.
+            PROFILE_ZONE("sim ticks");
+            sim.setViewpoint(camera.getPos()); // Bees in view steer every tick
+            int batch = warp > 0 ? warp : 1;
+            auto batchStart = std::chrono::steady_clock::now();
+            for (int i = 0; i < batch || (warp == 0 && std::chrono::steady_clock::now() - batchStart < std::chrono::milliseconds(50)); i++) {
+                sim.tick(sim.clock + tickSeconds, delta);
+                if (recorder) {
+                    recorder->record(sim);
+                }
 
-        // Manage flower lifecycle
-        if (std::chrono::duration_cast<std::chrono::seconds>(currentTime - flowerTimer).count() >= 10) {
-            if (!flowerPts.empty()) {
-                flowerPts.erase(flowerPts.begin()); // Remove the first flower
-                flowers.erase(flowers.begin());
+                // Hand a copy of the state to the checkpoint writer
+                if (checkpointer && sim.clock - lastCheckpoint >= checkpointInterval) {
+                    PROFILE_ZONE("checkpoint capture");
+                    checkpointer->submit(sim.capture());
+                    lastCheckpoint = sim.clock;
+                }
+
+                if (runFor > 0.0 && sim.clock - runStart >= runFor) {
+                    glfwSetWindowShouldClose(window, GLFW_TRUE);
+                    break;
+                }
             }
-            glm::vec3 newFlower;
-            do {
-               newFlower = glm::linearRand(bounds.min + glm::vec3(1.0f), bounds.max - glm::vec3(1.0f));
-            } while (glm::length(newFlower) < 10.0f); // Re-randomize if within 10 units of the origin
-            newFlower.y = land.getHeight(newFlower.x, newFlower.z) + 0.5f;
-            flowerPts.push_back(newFlower); // Add new flower point
-
-            flowers.emplace_back(std::make_shared<EcoObj>("flower_platform", shaderProgram, glm::vec3(1.0f, 0.4118f, 0.7059f), newFlower, glm::vec3(0, 0, 1)));
-            flowerTimer = currentTime;
-            std::cout << "As one blossom withers, another blooms." << std::endl;
         }
 
-        // Update and render swarm
-        std::vector<std::vector<glm::vec3>> swarmLocDir = getTeamLocDir(swarm);
-        std::vector<glm::vec3> tempFF = swarmLocDir[0];
-
-        for (const auto& bee : swarm) {
-            bee->move(delta, tempFF, flowerPts, bounds, swarmLocDir, land); // Move bee
-            bee->update(); // Update bee state
-            bee->display(view, projection, camera.getPos()); // Render bee
-            if (plnCount < 500) {
-                plnCount += bee->getPollen();
-                if (plnCount == 500) {
-                    std::cout << "Max Hive!!!" << std::endl;
-                    std::cout << std::chrono::duration_cast<std::chrono::seconds>(currentTime - timer).count() << std::endl;
+        // Time-warp without rendering: report progress in the title and skip the draw
+        if (warp == 0 && !replay) {
+            char title[128];
+            snprintf(title, sizeof(title), "Bee Sim - time warp: %.0f s simulated, %zu bees", sim.clock, sim.swarm.size());
+            glfwSetWindowTitle(window, title);
+            PROFILE_FRAME();
+            glfwPollEvents();
+            continue;
+        }
+
+        // Render swarm
+        {
+            GPU_ZONE("bees");
+            for (const auto& bee : sim.swarm) {
+                bee->display(view, projection, camera.getPos()); // Render bee
+            }
+            if (replay) {
+                for (const auto& b : replayFrame.bees) {
+                    replayBee->modelMatrix = Member::modelMatrixFor(b.p, b.d);
+                    replayBee->color = b.returning ? glm::vec3(1.0f, 0.5f, 0.0f) : glm::vec3(1.0f, 0.843f, 0.0f);
+                    replayBee->display(view, projection, camera.getPos()); // Render recorded bee
                 }
             }
         }
 
-        // Update and render flowers
-        for (const auto& flower : flowers) {
-            flower->setSize(0.0035); // Set flower size
-            flower->display(view, projection, camera.getPos()); // Render flower
+        // Render flowers
+        {
+            GPU_ZONE("flowers");
+            for (const auto& flower : sim.flowers) {
+                flower->setSize(0.0035); // Set flower size
+                flower->display(view, projection, camera.getPos()); // Render flower
+            }
         }
 
         // Render hive and land
-        hive.setSize(2.5 + (plnCount * 0.01)); // Update hive size
-        hive.turnUpsideDown(); // Animate hive
-        hive.display(view, projection, camera.getPos()); // Render hive
-        land.display(view, projection, camera.getPos()); // Render land
+        {
+            GPU_ZONE("hive + land");
+            sim.hive->display(view, projection, camera.getPos()); // Render hive
+            land.display(view, projection, camera.getPos()); // Render land
+        }
 
-        glfwSwapBuffers(window); // Swap front and back buffers
+        {
+            PROFILE_ZONE("glfwSwapBuffers");
+            glfwSwapBuffers(window); // Swap front and back buffers
+        }
+        PROFILE_FRAME(); // Collect zones and finished GPU timers
+        telemetryAdd(telemetry().frameAllocs, frameAllocs.count());
+        telemetryAdd(telemetry().frames, 1);
+
+        if (firstFrame) {
+            firstFrame = false;
+            startup.report();
+            std::cout << "time_to_first_frame_ms=" << startup.elapsedMs() << std::endl;
+            MemoryAccounts& accounts = memoryAccounts();
+            std::cout << "memory (cpu/gpu MB):";
+            for (int tag = 0; tag < memoryTagCount; tag++) {
+                std::cout << " " << memoryTagName(tag) << " " << accounts.cpu[tag].load() / (1024 * 1024.0)
+                    << "/" << accounts.gpu[tag].load() / (1024 * 1024.0);
+            }
+            std::cout << std::endl;
+        }
         glfwPollEvents(); // Poll for and process events
     }
 
+    if (warp >= 0 && !replay) {
+        double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - wallStart).count();
+        std::cout << "time_warp simulated_s=" << (sim.clock - runStart) << " wall_s=" << wall
+            << " ticks=" << sim.tickCount << " bees=" << sim.swarm.size() << " hive_pollen=" << sim.plnCount << std::endl;
+    }
+
+    PROFILE_EXPORT("profile.json"); // Chrome trace + zone histograms (profiler builds only)
+    publisher.reset(); // Final snapshot, then join the publisher thread
+    if (checkpointer) {
+        checkpointer->submit(sim.capture()); // Final checkpoint, written before the writer stops
+        checkpointer.reset();
+    }
+    recorder.reset(); // Last chunk and the seek index
+
     glfwTerminate(); // Clean up and terminate GLFW
     return 0;
 }
\ No newline at end of file
@@ -10,8 +10,40 @@
 #include <Windows.h>
 #include <GL/glew.h>
 #include <stdio.h>
+#include <string.h>
 #include "Shaders.h"
 #include <stdarg.h>
+#include <direct.h>
+#include <map>
+#include <mutex>
+#include <string>
+#ifdef EMBED_MESHES
+#include "generated/EmbeddedMeshes.h" // Written by embed_meshes at build time
+#endif
+
+/*
+ *  Directory holding cached program binaries, keyed by source and
+ *  driver hash. It sits next to the executable rather than under the
+ *  working directory, so the cache works wherever the program starts.
+ */
+static const char *shaderCacheDir() {
+	static char dir[MAX_PATH] = "";
+	char *slash;
+
+	if(dir[0] == 0) {
+		if(GetModuleFileNameA(NULL, dir, MAX_PATH) == 0)
+			dir[0] = 0;
+		slash = strrchr(dir, '\\');
+		if(slash == NULL)
+			slash = strrchr(dir, '/');
+		if(slash != NULL)
+			slash[1] = 0;
+		else
+			dir[0] = 0;
+		strncat(dir, "shader_cache", MAX_PATH - strlen(dir) - 1);
+	}
+	return(dir);
+}
 
 char *readShaderFile(char *filename) {
 	FILE *fid;
@@ -19,6 +51,16 @@ char *readShaderFile(char *filename) {
 	int len;
 	int n;
 
+#ifdef EMBED_MESHES
+	// Sources baked into the executable never touch the file system
+	const embedded::EmbeddedFile *baked = embedded::findFile(filename);
+	if(baked != NULL) {
+		buffer = new char[baked->length+1];
+		memcpy(buffer, baked->text, baked->length+1);
+		return buffer;
+	}
+#endif
+
 	fid = fopen(filename,"r");
 	if(fid == NULL) {
 		printf("can't open shader file: %s\n", filename);
@@ -32,22 +74,18 @@ char *readShaderFile(char *filename) {
 	buffer = new char[len+1];
 	n = fread(buffer, sizeof(char), len, fid);
 	buffer[n] = 0;
+	fclose(fid);
 
 	return buffer;
 
 }
 
-int buildShader(int type, char *filename) {
+static int compileShader(int type, const char *source, const char *filename) {
 	int shader;
-	char *source;
 	int result;
 	char *buffer;
 
 	shader = glCreateShader(type);
-	source = readShaderFile(filename);
-	if(source == 0)
-		return 0;
-
 	glShaderSource(shader, 1, (const  GLchar **) &source, 0);
 	glCompileShader(shader);
 	glGetShaderiv(shader, GL_COMPILE_STATUS, &result);
@@ -57,16 +95,47 @@ int buildShader(int type, char *filename) {
 		buffer = new char[result];
 		glGetShaderInfoLog(shader, result, 0, buffer);
 		printf("%s\n", buffer);
-		delete buffer;
+		delete[] buffer;
+		glDeleteShader(shader);
 		return(0);
 	}
 
 	return(shader);
 }
 
-int buildProgram(int first, ...) {
+static int checkLink(int program) {
 	int result;
 	char *buffer;
+
+	glGetProgramiv(program, GL_LINK_STATUS, &result);
+	if(result != GL_TRUE) {
+		printf("program link error\n");
+		glGetProgramiv(program, GL_INFO_LOG_LENGTH, &result);
+		buffer = new char[result];
+		glGetProgramInfoLog(program, result, 0, buffer);
+		printf("%s\n",buffer);
+		delete[] buffer;
+		return(0);
+	}
+
+	return(program);
+}
+
+int buildShader(int type, char *filename) {
+	int shader;
+	char *source;
+
+	source = readShaderFile(filename);
+	if(source == 0)
+		return 0;
+
+	shader = compileShader(type, source, filename);
+	delete[] source;
+
+	return(shader);
+}
+
+int buildProgram(int first, ...) {
 	int program;
 	va_list argptr;
 	int shader;
@@ -93,6 +162,7 @@ int buildProgram(int first, ...) {
 		if(type == GL_FRAGMENT_SHADER)
 			fs++;
 	}
+	va_end(argptr);
 
 	if(vs == 0) {
 		printf("no vertex shader\n");
@@ -101,19 +171,196 @@ int buildProgram(int first, ...) {
 		printf("no fragment shader\n");
 	}
 	glLinkProgram(program);
+
+	return(checkLink(program));
+
+}
+
+/*
+ *  FNV-1a hash, used to key cached program binaries
+ */
+static unsigned long long hashString(unsigned long long hash, const char *str) {
+	while(*str) {
+		hash ^= (unsigned char) *str++;
+		hash *= 1099511628211ULL;
+	}
+	return hash;
+}
+
+static int loadProgramBinary(const char *path) {
+	FILE *fid;
+	GLenum format;
+	long len;
+	char *buffer;
+	int program;
+	int result;
+
+	fid = fopen(path, "rb");
+	if(fid == NULL)
+		return(0);
+
+	fseek(fid, 0, SEEK_END);
+	len = ftell(fid) - (long) sizeof(format);
+	rewind(fid);
+	if(len <= 0 || fread(&format, sizeof(format), 1, fid) != 1) {
+		fclose(fid);
+		return(0);
+	}
+
+	buffer = new char[len];
+	if(fread(buffer, 1, len, fid) != (size_t) len) {
+		delete[] buffer;
+		fclose(fid);
+		return(0);
+	}
+	fclose(fid);
+
+	program = glCreateProgram();
+	glProgramBinary(program, format, buffer, len);
+	delete[] buffer;
+
 	glGetProgramiv(program, GL_LINK_STATUS, &result);
 	if(result != GL_TRUE) {
-		printf("program link error\n");
-		glGetProgramiv(program, GL_INFO_LOG_LENGTH, &result);
-		buffer = new char[result];
-		glGetProgramInfoLog(program, result, 0, buffer);
-		printf("%s\n",buffer);
-		delete buffer;
+		// Stale or rejected binary, caller falls back to a full compile
+		glDeleteProgram(program);
 		return(0);
 	}
 
 	return(program);
+}
+
+static void saveProgramBinary(int program, const char *path) {
+	FILE *fid;
+	GLint len;
+	GLenum format;
+	char *buffer;
+
+	glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &len);
+	if(len <= 0)
+		return;
+
+	buffer = new char[len];
+	glGetProgramBinary(program, len, 0, &format, buffer);
+
+	_mkdir(shaderCacheDir());
+	fid = fopen(path, "wb");
+	if(fid != NULL) {
+		fwrite(&format, sizeof(format), 1, fid);
+		fwrite(buffer, 1, len, fid);
+		fclose(fid);
+	}
+	delete[] buffer;
+}
 
+/*
+ *  Shader sources read ahead of time by prepareProgram, so the
+ *  file I/O can happen on a worker thread before a GL context exists.
+ */
+static std::mutex preparedMutex;
+static std::map<std::string, std::string> preparedSources;
+
+void prepareProgram(char *vsName, char *fsName) {
+	char *names[2] = { vsName, fsName };
+	char *source;
+	int i;
+
+	for(i=0; i<2; i++) {
+		source = readShaderFile(names[i]);
+		if(source == 0)
+			continue;
+		std::lock_guard<std::mutex> lock(preparedMutex);
+		preparedSources[names[i]] = source;
+		delete[] source;
+	}
+}
+
+static char *takeShaderSource(char *filename) {
+	std::map<std::string, std::string>::iterator it;
+	char *buffer;
+
+	{
+		std::lock_guard<std::mutex> lock(preparedMutex);
+		it = preparedSources.find(filename);
+		if(it != preparedSources.end()) {
+			buffer = new char[it->second.size()+1];
+			memcpy(buffer, it->second.c_str(), it->second.size()+1);
+			preparedSources.erase(it);
+			return buffer;
+		}
+	}
+
+	return readShaderFile(filename);
+}
+
+/*
+ *  Return the program for a (vertex, fragment) shader pair. Each
+ *  pair is built once per run and reused by every caller. Linked
+ *  binaries are cached on disk, keyed by a hash of both sources and
+ *  the driver strings, so later runs skip compilation entirely.
+ */
+int getProgram(char *vsName, char *fsName) {
+	static std::map<std::string, int> registry;
+	std::string key = std::string(vsName) + "|" + fsName;
+	std::map<std::string, int>::iterator it;
+	char *vsSource;
+	char *fsSource;
+	char path[MAX_PATH+32];
+	unsigned long long hash;
+	int formats;
+	int program;
+	int vs;
+	int fs;
+
+	it = registry.find(key);
+	if(it != registry.end())
+		return(it->second);
+
+	vsSource = takeShaderSource(vsName);
+	fsSource = takeShaderSource(fsName);
+	if(vsSource == 0 || fsSource == 0) {
+		delete[] vsSource;
+		delete[] fsSource;
+		return(0);
+	}
+
+	hash = 14695981039346656037ULL;
+	hash = hashString(hash, vsSource);
+	hash = hashString(hash, "|");
+	hash = hashString(hash, fsSource);
+	hash = hashString(hash, (const char *) glGetString(GL_VENDOR));
+	hash = hashString(hash, (const char *) glGetString(GL_RENDERER));
+	hash = hashString(hash, (const char *) glGetString(GL_VERSION));
+	sprintf(path, "%s/%016llx.bin", shaderCacheDir(), hash);
+
+	glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+
+	program = 0;
+	if(formats > 0)
+		program = loadProgramBinary(path);
+
+	if(program == 0) {
+		vs = compileShader(GL_VERTEX_SHADER, vsSource, vsName);
+		fs = compileShader(GL_FRAGMENT_SHADER, fsSource, fsName);
+		if(vs != 0 && fs != 0) {
+			program = glCreateProgram();
+			glAttachShader(program, vs);
+			glAttachShader(program, fs);
+			glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+			glLinkProgram(program);
+			program = checkLink(program);
+			if(program != 0 && formats > 0)
+				saveProgramBinary(program, path);
+		}
+		glDeleteShader(vs);
+		glDeleteShader(fs);
+	}
+
+	delete[] vsSource;
+	delete[] fsSource;
+
+	if(program != 0)
+		registry[key] = program;
+	return(program);
 }
 
 void dumpProgram(int program, char *description) {
@@ -9,4 +9,6 @@
 
 int buildShader(int type, char *filename);
 int buildProgram(int first, ...);
+int getProgram(char *vsName, char *fsName);
+void prepareProgram(char *vsName, char *fsName);
 void dumpProgram(int program, char *description);
\ No newline at end of file
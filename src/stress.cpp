@@ -0,0 +1,407 @@
+/************************************************
+ *
+ *       CSCI 4110 Project - Bee Simulation
+ *       Scaling stress harness (Stress project)
+ *
+ *  Runs the full simulation tick (spawning, flower
+ *  lifecycle, movement, pollen and hive growth)
+ *  without a window over a grid of swarm sizes,
+ *  flower counts and terrain exponents, and writes
+ *  ticks/s, peak RSS and tick latency percentiles
+ *  as CSV. Each configuration runs in a child
+ *  process so peak RSS belongs to that run alone.
+ *  Fails if a steady-state tick (one where no bee
+ *  spawned and no flower was replaced) allocates.
+ *  --nectar sets the loads a full flower holds
+ *  (0 for no limit); the CSV counts the nectar
+ *  claims lost to another bee at the same flower.
+ *
+ *  usage: Stress [--bees a,b,..] [--flowers a,b,..]
+ *                [--terrain a,b,..] [--ticks N]
+ *                [--warmup N] [--dt s] [--step s] [--csv file]
+ *                [--threshold k] [--theta t]
+ *                [--lod-slices K] [--nectar L]
+ *                [--in-process]
+ *
+ ************************************************/
+
+#include <Windows.h>
+#include <psapi.h>
+#include <gl/glew.h>
+#define GLM_FORCE_RADIANS
+#include <glm/glm.hpp>
+#include "Object.h"
+#include "LandMass.h"
+#include "Simulation.h"
+#include "AllocationHook.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+struct StressConfig {
+    int bees;    // Swarm size at the start of the run
+    int flowers; // Flowers alive at any time
+    int terrain; // Terrain exponent n (grid side 2^n + 1)
+};
+
+struct StressResult {
+    StressConfig config;
+    int ticks;          // Timed ticks
+    double ticksPerSec; // Timed ticks / wall time
+    double meanMs;      // Mean tick time
+    double p50Ms;       // Median tick time
+    double p99Ms;       // 99th percentile tick time
+    double p999Ms;      // 99.9th percentile tick time
+    double maxMs;       // Slowest tick
+    double peakRssMb;   // Peak working set of the run
+    int finalBees;      // Swarm size when the run ended
+    int pollen;         // Pollen delivered during the run
+    int allocTicks;     // Steady-state ticks that touched the heap (should be 0)
+    double steerFraction; // Bee updates that ran full steering rather than coasting
+    long long contended; // Nectar claims lost to another bee at the same flower
+    int busiestFlower;  // Most claims one living flower had turned away when the run ended
+    double exponent[3]; // Cost growth (size^k) from the previous point on each axis, 0 for the first
+    std::string nonlinear; // Axes on which this point stopped scaling linearly
+};
+
+struct StressOptions {
+    std::vector<int> bees = { 25, 100, 400, 1600 };
+    std::vector<int> flowers = { 50, 200 };
+    std::vector<int> terrain = { 6, 8, 10 };
+    int ticks = 600;             // Timed ticks per configuration
+    int warmup = 20;             // Untimed ticks before measuring
+    double dt = 0.05;            // Simulated seconds per tick (swap interval 3 at 60 Hz)
+    float step = 0.1f;           // Movement step per tick; raise it to fast-forward
+    double threshold = 1.25;     // Scaling exponent above which a point is flagged
+    std::string csvPath = "stress.csv";
+    bool inProcess = false;      // Run every configuration in this process
+    float theta = SimulationConfig().cohesionTheta; // Swarm cohesion opening angle
+    int lodSlices = SimulationConfig().lodSlices;   // Behavior LOD time slices for bees in transit
+    float nectar = SimulationConfig().nectarLoads;     // Loads a full flower holds, 0 for no limit
+};
+
+static StressOptions options;
+static const char* axisNames[3] = { "bees", "flowers", "terrain" };
+
+// Silences std::cout for its lifetime (fractleGen logs every call)
+class QuietCout {
+private:
+    std::streambuf* saved;
+    std::ostringstream sink;
+
+public:
+    QuietCout() : saved(std::cout.rdbuf(sink.rdbuf())) {}
+    ~QuietCout() { std::cout.rdbuf(saved); }
+};
+
+static std::vector<int> parseList(const char* text) {
+    std::vector<int> values;
+    std::istringstream iss(text);
+    std::string item;
+    while (std::getline(iss, item, ',')) {
+        if (!item.empty()) values.push_back(atoi(item.c_str()));
+    }
+    return values;
+}
+
+static double peakRssMb() {
+    PROCESS_MEMORY_COUNTERS counters;
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+        return 0.0;
+    }
+    return counters.PeakWorkingSetSize / (1024.0 * 1024.0);
+}
+
+// Nearest-rank percentile of sorted samples
+static double percentile(const std::vector<double>& sorted, double q) {
+    if (sorted.empty()) return 0.0;
+    size_t rank = (size_t)std::ceil(q * sorted.size());
+    return sorted[rank > 0 ? rank - 1 : 0];
+}
+
+// Build the colony and time `ticks` simulation ticks
+static StressResult runConfig(const StressConfig& c) {
+    std::srand(1234); // Same swarm and flower layout for every configuration
+
+    std::unique_ptr<LandMass> land;
+    {
+        QuietCout quiet;
+        land.reset(new LandMass(c.terrain));
+    }
+    land->discardMeshData();
+
+    SimulationConfig simConfig;
+    simConfig.initialBees = c.bees;
+    simConfig.maxBees = c.bees + (c.bees / 10 > 1 ? c.bees / 10 : 1); // Leave room to exercise spawning
+    simConfig.flowerCount = c.flowers;
+    simConfig.cohesionTheta = options.theta;
+    simConfig.lodSlices = options.lodSlices;
+    simConfig.nectarLoads = options.nectar;
+    simConfig.seed = SimRandom::randomSeed();
+    Simulation sim(*land, 0, simConfig, nullptr);
+
+    double now = 0.0;
+    for (int i = 0; i < options.warmup; i++) {
+        now += options.dt;
+        sim.tick(now, options.step);
+    }
+
+    std::vector<double> samples;
+    samples.reserve(options.ticks);
+    TelemetryCounters& stats = telemetry();
+    int allocTicks = 0;
+    long long steers = 0;
+    long long beeTicks = 0;
+    long long contendedBefore = sim.nectarContended(); // From the colony, not telemetry: a reference colony adds to that too
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < options.ticks; i++) {
+        now += options.dt;
+        long long eventsBefore = stats.beesBorn.load() + stats.flowersReplaced.load();
+        long long steersBefore = stats.lodSteers.load();
+        auto tickStart = std::chrono::steady_clock::now();
+        AllocationScope allocs;
+        sim.tick(now, options.step);
+        unsigned long long allocated = allocs.count();
+        steers += stats.lodSteers.load() - steersBefore;
+        beeTicks += (long long)sim.swarm.size();
+        samples.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - tickStart).count());
+        if (allocated > 0 && stats.beesBorn.load() + stats.flowersReplaced.load() == eventsBefore) {
+            allocTicks++; // Spawns and new flowers build objects; nothing else may allocate
+        }
+    }
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    StressResult r = StressResult();
+    r.config = c;
+    r.ticks = options.ticks;
+    r.ticksPerSec = elapsed > 0.0 ? options.ticks / elapsed : 0.0;
+    double sum = 0.0;
+    for (double s : samples) sum += s;
+    r.meanMs = samples.empty() ? 0.0 : sum / samples.size();
+    std::sort(samples.begin(), samples.end());
+    r.p50Ms = percentile(samples, 0.50);
+    r.p99Ms = percentile(samples, 0.99);
+    r.p999Ms = percentile(samples, 0.999);
+    r.maxMs = samples.empty() ? 0.0 : samples.back();
+    r.peakRssMb = peakRssMb();
+    r.finalBees = (int)sim.swarm.size();
+    r.pollen = sim.plnCount;
+    r.allocTicks = allocTicks;
+    r.steerFraction = beeTicks > 0 ? double(steers) / beeTicks : 0.0;
+    r.contended = sim.nectarContended() - contendedBefore;
+    r.busiestFlower = sim.busiestFlower();
+    return r;
+}
+
+// Child-process line: RESULT,<fields> in the order parseResult expects
+static void printResultLine(const StressResult& r) {
+    printf("RESULT,%d,%d,%d,%d,%.3f,%.4f,%.4f,%.4f,%.4f,%.4f,%.2f,%d,%d,%d,%.4f,%lld,%d\n",
+        r.config.bees, r.config.flowers, r.config.terrain, r.ticks, r.ticksPerSec,
+        r.meanMs, r.p50Ms, r.p99Ms, r.p999Ms, r.maxMs, r.peakRssMb, r.finalBees, r.pollen, r.allocTicks,
+        r.steerFraction, r.contended, r.busiestFlower);
+    fflush(stdout);
+}
+
+static bool parseResult(const char* line, StressResult& r) {
+    r = StressResult();
+    return sscanf(line, "RESULT,%d,%d,%d,%d,%lf,%lf,%lf,%lf,%lf,%lf,%lf,%d,%d,%d,%lf,%lld,%d",
+        &r.config.bees, &r.config.flowers, &r.config.terrain, &r.ticks, &r.ticksPerSec,
+        &r.meanMs, &r.p50Ms, &r.p99Ms, &r.p999Ms, &r.maxMs, &r.peakRssMb, &r.finalBees, &r.pollen, &r.allocTicks,
+        &r.steerFraction, &r.contended, &r.busiestFlower) == 17;
+}
+
+// Run one configuration in a fresh copy of this executable
+static bool runChild(const std::string& exe, const StressConfig& c, StressResult& r) {
+    std::ostringstream cmd;
+    cmd << "\"\"" << exe << "\" --run " << c.bees << " " << c.flowers << " " << c.terrain
+        << " --ticks " << options.ticks << " --warmup " << options.warmup << " --dt " << options.dt << " --step " << options.step
+        << " --theta " << options.theta << " --lod-slices " << options.lodSlices << " --nectar " << options.nectar << "\"";
+
+    FILE* pipe = _popen(cmd.str().c_str(), "r");
+    if (pipe == NULL) {
+        return false;
+    }
+    bool found = false;
+    char line[512];
+    while (fgets(line, sizeof(line), pipe) != NULL) {
+        if (strncmp(line, "RESULT,", 7) == 0) {
+            found = parseResult(line, r);
+        }
+    }
+    return _pclose(pipe) == 0 && found;
+}
+
+// Problem size along an axis: bees, flowers, or terrain grid cells
+static double axisSize(const StressConfig& c, int axis) {
+    if (axis == 0) return c.bees;
+    if (axis == 1) return c.flowers;
+    double side = std::pow(2.0, (double)c.terrain) + 1.0;
+    return side * side;
+}
+
+static bool sameOtherAxes(const StressConfig& a, const StressConfig& b, int axis) {
+    return (axis == 0 || a.bees == b.bees)
+        && (axis == 1 || a.flowers == b.flowers)
+        && (axis == 2 || a.terrain == b.terrain);
+}
+
+// For every point, the cost exponent against the next smaller point on each
+// axis with the other two held fixed. Above the threshold scaling is superlinear.
+static void classifyScaling(std::vector<StressResult>& results) {
+    for (auto& r : results) {
+        for (int axis = 0; axis < 3; axis++) {
+            const StressResult* prev = nullptr;
+            for (const auto& q : results) {
+                if (!sameOtherAxes(q.config, r.config, axis) || axisSize(q.config, axis) >= axisSize(r.config, axis)) continue;
+                if (prev == nullptr || axisSize(q.config, axis) > axisSize(prev->config, axis)) prev = &q;
+            }
+            r.exponent[axis] = 0.0;
+            if (prev == nullptr || prev->meanMs <= 0.0 || r.meanMs <= 0.0) continue;
+            r.exponent[axis] = std::log(r.meanMs / prev->meanMs) / std::log(axisSize(r.config, axis) / axisSize(prev->config, axis));
+            if (r.exponent[axis] > options.threshold) {
+                if (!r.nonlinear.empty()) r.nonlinear += "+";
+                r.nonlinear += axisNames[axis];
+            }
+        }
+    }
+}
+
+// Print where each sweep line first stops scaling linearly
+static void reportKnees(const std::vector<StressResult>& results) {
+    for (int axis = 0; axis < 3; axis++) {
+        std::vector<const StressResult*> reported;
+        for (const auto& r : results) {
+            if (r.exponent[axis] <= options.threshold) continue;
+            bool seen = false;
+            for (const auto* k : reported) {
+                if (sameOtherAxes(k->config, r.config, axis)) seen = true;
+            }
+            if (seen) continue;
+            for (const auto& q : results) {
+                if (sameOtherAxes(q.config, r.config, axis) && q.exponent[axis] > options.threshold
+                    && axisSize(q.config, axis) < axisSize(r.config, axis)) {
+                    seen = true; // A smaller point on this line was flagged first
+                }
+            }
+            if (seen) continue;
+            reported.push_back(&r);
+            std::cout << "  " << axisNames[axis] << ": superlinear at bees=" << r.config.bees
+                << " flowers=" << r.config.flowers << " n=" << r.config.terrain
+                << " (cost ~ size^" << std::fixed << std::setprecision(2) << r.exponent[axis] << ")" << std::endl;
+        }
+    }
+}
+
+static void writeCsv(const std::string& path, const std::vector<StressResult>& results) {
+    FILE* fid = fopen(path.c_str(), "w");
+    if (fid == NULL) {
+        std::cerr << "can't open " << path << std::endl;
+        return;
+    }
+    fprintf(fid, "bees,flowers,terrain_n,ticks,ticks_per_s,mean_ms,p50_ms,p99_ms,p999_ms,max_ms,peak_rss_mb,"
+        "final_bees,pollen,alloc_ticks,steer_fraction,contended_claims,busiest_flower,"
+        "exp_bees,exp_flowers,exp_terrain,nonlinear\n");
+    for (const auto& r : results) {
+        fprintf(fid, "%d,%d,%d,%d,%.3f,%.4f,%.4f,%.4f,%.4f,%.4f,%.2f,%d,%d,%d,%.4f,%lld,%d,%.3f,%.3f,%.3f,%s\n",
+            r.config.bees, r.config.flowers, r.config.terrain, r.ticks, r.ticksPerSec,
+            r.meanMs, r.p50Ms, r.p99Ms, r.p999Ms, r.maxMs, r.peakRssMb, r.finalBees, r.pollen, r.allocTicks,
+            r.steerFraction, r.contended, r.busiestFlower,
+            r.exponent[0], r.exponent[1], r.exponent[2], r.nonlinear.c_str());
+    }
+    fclose(fid);
+    std::cout << "Wrote " << results.size() << " configurations to " << path << std::endl;
+}
+
+static int usage() {
+    fprintf(stderr, "usage: Stress [--bees a,b,..] [--flowers a,b,..] [--terrain a,b,..] [--ticks N]\n"
+        "              [--warmup N] [--dt s] [--step s] [--csv file] [--threshold k] [--theta t]\n"
+        "              [--lod-slices K] [--nectar L] [--in-process]\n");
+    return 1;
+}
+
+int main(int argc, char** argv) {
+    bool child = false;
+    StressConfig single = { 0, 0, 0 };
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--bees") && i + 1 < argc) options.bees = parseList(argv[++i]);
+        else if (!strcmp(argv[i], "--flowers") && i + 1 < argc) options.flowers = parseList(argv[++i]);
+        else if (!strcmp(argv[i], "--terrain") && i + 1 < argc) options.terrain = parseList(argv[++i]);
+        else if (!strcmp(argv[i], "--ticks") && i + 1 < argc) options.ticks = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--warmup") && i + 1 < argc) options.warmup = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--dt") && i + 1 < argc) options.dt = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--step") && i + 1 < argc) options.step = (float)atof(argv[++i]);
+        else if (!strcmp(argv[i], "--csv") && i + 1 < argc) options.csvPath = argv[++i];
+        else if (!strcmp(argv[i], "--threshold") && i + 1 < argc) options.threshold = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--theta") && i + 1 < argc) options.theta = (float)atof(argv[++i]);
+        else if (!strcmp(argv[i], "--lod-slices") && i + 1 < argc) options.lodSlices = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--nectar") && i + 1 < argc) options.nectar = (float)atof(argv[++i]);
+        else if (!strcmp(argv[i], "--in-process")) options.inProcess = true;
+        else if (!strcmp(argv[i], "--run") && i + 3 < argc) {
+            child = true;
+            single.bees = atoi(argv[++i]);
+            single.flowers = atoi(argv[++i]);
+            single.terrain = atoi(argv[++i]);
+        }
+        else return usage();
+    }
+
+    Object::headless() = true; // No GL context, simulation only
+
+    if (child) {
+        printResultLine(runConfig(single));
+        return 0;
+    }
+
+    std::cout << std::left << std::setw(8) << "bees" << std::setw(9) << "flowers" << std::setw(4) << "n"
+        << std::right << std::setw(12) << "ticks/s" << std::setw(10) << "p50 ms" << std::setw(10) << "p99 ms"
+        << std::setw(10) << "p99.9 ms" << std::setw(10) << "max ms" << std::setw(10) << "rss MB" << std::endl;
+
+    std::vector<StressResult> results;
+    for (int n : options.terrain) {
+        for (int f : options.flowers) {
+            for (int b : options.bees) {
+                StressConfig c = { b, f, n };
+                StressResult r;
+                if (options.inProcess) {
+                    r = runConfig(c);
+                }
+                else if (!runChild(argv[0], c, r)) {
+                    std::cerr << "configuration bees=" << b << " flowers=" << f << " n=" << n << " failed" << std::endl;
+                    continue;
+                }
+                results.push_back(r);
+
+                std::cout << std::left << std::setw(8) << b << std::setw(9) << f << std::setw(4) << n
+                    << std::right << std::fixed << std::setprecision(1) << std::setw(12) << r.ticksPerSec
+                    << std::setprecision(3) << std::setw(10) << r.p50Ms << std::setw(10) << r.p99Ms
+                    << std::setw(10) << r.p999Ms << std::setw(10) << r.maxMs
+                    << std::setprecision(1) << std::setw(10) << r.peakRssMb << std::endl;
+            }
+        }
+    }
+
+    classifyScaling(results);
+    std::cout << "Scaling (flagged above size^" << std::setprecision(2) << options.threshold << "):" << std::endl;
+    reportKnees(results);
+    writeCsv(options.csvPath, results);
+
+    // Steady-state ticks must run entirely out of the tick arena
+    int failures = 0;
+    for (const auto& r : results) {
+        if (r.allocTicks > 0) {
+            std::cerr << "FAIL: " << r.allocTicks << " steady-state ticks allocated at bees=" << r.config.bees
+                << " flowers=" << r.config.flowers << " n=" << r.config.terrain << std::endl;
+            failures++;
+        }
+    }
+    return failures > 0 ? 1 : 0;
+}
\ No newline at end of file
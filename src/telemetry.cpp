@@ -0,0 +1,208 @@
+/************************************************
+ *
+ *       CSCI 4110 Project - Bee Simulation
+ *       Telemetry publisher
+ *
+ *  Snapshots the relaxed counters in Telemetry.h
+ *  on a background thread and writes them as JSON
+ *  lines to a file or a Unix domain socket.
+ *
+ ************************************************/
+
+// Winsock must be included before Windows.h pulls in the old winsock.h
+#include <winsock2.h>
+#include <afunix.h>
+#include <Windows.h>
+#include <psapi.h>
+#include "Telemetry.h"
+#include "MemoryBudget.h"
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+// Current working set of the process
+static double residentMb() {
+    PROCESS_MEMORY_COUNTERS counters;
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+        return 0.0;
+    }
+    return counters.WorkingSetSize / (1024.0 * 1024.0);
+}
+
+// Connect to a listening Unix domain socket, INVALID_SOCKET if nobody listens
+static SOCKET connectUnix(const std::string& path) {
+    SOCKET s = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (s == INVALID_SOCKET) {
+        return s;
+    }
+    sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+    if (connect(s, (sockaddr*)&addr, sizeof(addr)) == SOCKET_ERROR) {
+        closesocket(s);
+        return INVALID_SOCKET;
+    }
+    return s;
+}
+
+TelemetryPublisher::TelemetryPublisher(const std::string& target, int intervalMs)
+    : target(target), intervalMs(intervalMs > 0 ? intervalMs : 1000), stopping(false) {}
+
+TelemetryPublisher::~TelemetryPublisher() {
+    stop();
+}
+
+bool TelemetryPublisher::start() {
+    if (target.empty() || target == "file:" || target == "unix:") {
+        return false;
+    }
+    stopping = false;
+    worker = std::thread(&TelemetryPublisher::run, this);
+    return true;
+}
+
+void TelemetryPublisher::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    if (worker.joinable()) {
+        worker.join();
+    }
+}
+
+void TelemetryPublisher::run() {
+    bool socketMode = target.compare(0, 5, "unix:") == 0;
+    std::string path = (socketMode || target.compare(0, 5, "file:") == 0) ? target.substr(5) : target;
+
+    FILE* file = NULL;
+    SOCKET sock = INVALID_SOCKET;
+    if (socketMode) {
+        WSADATA wsa;
+        if (WSAStartup(MAKEWORD(2, 2), &wsa) != 0) {
+            std::cerr << "telemetry: can't initialize Winsock" << std::endl;
+            return;
+        }
+    }
+    else {
+        file = fopen(path.c_str(), "a");
+        if (file == NULL) {
+            std::cerr << "telemetry: can't open " << path << std::endl;
+            return;
+        }
+    }
+
+    TelemetryCounters& t = telemetry();
+    auto origin = std::chrono::steady_clock::now();
+    auto last = origin;
+    long long lastPollen = t.pollenDelivered.load(std::memory_order_relaxed);
+    long long lastTicks = t.ticks.load(std::memory_order_relaxed);
+    long long lastFrames = t.frames.load(std::memory_order_relaxed);
+    long long lastDraws = t.drawCalls.load(std::memory_order_relaxed);
+    long long lastAllocs = t.frameAllocs.load(std::memory_order_relaxed);
+    long long lastSteers = t.lodSteers.load(std::memory_order_relaxed);
+    long long lastCapped = t.lodCapped.load(std::memory_order_relaxed);
+    long long lastCollected = t.nectarCollected.load(std::memory_order_relaxed);
+    long long lastContended = t.nectarContended.load(std::memory_order_relaxed);
+    AtomicHistogram::Snapshot tickSnapshot;
+
+    std::unique_lock<std::mutex> lock(mutex);
+    bool done = false;
+    while (!done) {
+        done = wake.wait_for(lock, std::chrono::milliseconds(intervalMs), [this]() { return stopping; });
+        lock.unlock();
+
+        auto now = std::chrono::steady_clock::now();
+        double seconds = std::chrono::duration<double>(now - last).count();
+        if (seconds <= 0.0) seconds = 1e-9;
+        last = now;
+
+        long long pollen = t.pollenDelivered.load(std::memory_order_relaxed);
+        long long ticks = t.ticks.load(std::memory_order_relaxed);
+        long long frames = t.frames.load(std::memory_order_relaxed);
+        long long draws = t.drawCalls.load(std::memory_order_relaxed);
+        long long allocs = t.frameAllocs.load(std::memory_order_relaxed);
+        long long steers = t.lodSteers.load(std::memory_order_relaxed);
+        long long capped = t.lodCapped.load(std::memory_order_relaxed);
+        long long collected = t.nectarCollected.load(std::memory_order_relaxed);
+        long long contended = t.nectarContended.load(std::memory_order_relaxed);
+        double tickCount = ticks > lastTicks ? double(ticks - lastTicks) : 1.0;
+        t.tickUs.drain(tickSnapshot);
+
+        // Live memory per subsystem
+        MemoryAccounts& accounts = memoryAccounts();
+        char memory[1024];
+        int memoryLength = 0;
+        for (int tag = 0; tag < memoryTagCount && memoryLength < (int)sizeof(memory); tag++) {
+            memoryLength += snprintf(memory + memoryLength, sizeof(memory) - memoryLength,
+                "%s\"%s\": {\"cpu_mb\": %.2f, \"gpu_mb\": %.2f}", tag > 0 ? ", " : "", memoryTagName(tag),
+                accounts.cpu[tag].load(std::memory_order_relaxed) / (1024.0 * 1024.0),
+                accounts.gpu[tag].load(std::memory_order_relaxed) / (1024.0 * 1024.0));
+        }
+
+        char line[2048];
+        int length = snprintf(line, sizeof(line),
+            "{\"t_ms\": %.0f, \"bees_alive\": %d, \"bees_returning\": %d, \"flowers\": %d, "
+            "\"hive_pollen\": %d, \"pollen_total\": %lld, \"pollen_per_s\": %.2f, "
+            "\"bees_born\": %lld, \"spawns_capped\": %lld, \"flowers_replaced\": %lld, \"ticks_per_s\": %.1f, "
+            "\"tick_p50_ms\": %.3f, \"tick_p99_ms\": %.3f, \"tick_max_ms\": %.3f, "
+            "\"lod\": {\"near\": %d, \"busy\": %d, \"transit\": %d, \"steers_per_tick\": %.1f, \"capped_per_tick\": %.1f}, "
+            "\"nectar\": {\"collected_per_s\": %.2f, \"contended_per_s\": %.2f, \"busiest_flower\": %d}, "
+            "\"frames_per_s\": %.1f, \"draw_calls_per_frame\": %.1f, \"allocs_per_frame\": %.1f, \"rss_mb\": %.1f, "
+            "\"memory\": {%s}}\n",
+            std::chrono::duration<double, std::milli>(now - origin).count(),
+            t.beesAlive.load(std::memory_order_relaxed), t.beesReturning.load(std::memory_order_relaxed),
+            t.flowers.load(std::memory_order_relaxed), t.hivePollen.load(std::memory_order_relaxed),
+            pollen, (pollen - lastPollen) / seconds,
+            t.beesBorn.load(std::memory_order_relaxed), t.spawnsCapped.load(std::memory_order_relaxed),
+            t.flowersReplaced.load(std::memory_order_relaxed),
+            (ticks - lastTicks) / seconds,
+            tickSnapshot.percentile(0.50) / 1000.0, tickSnapshot.percentile(0.99) / 1000.0, tickSnapshot.maxUs / 1000.0,
+            t.lodNear.load(std::memory_order_relaxed), t.lodBusy.load(std::memory_order_relaxed),
+            t.lodTransit.load(std::memory_order_relaxed), (steers - lastSteers) / tickCount, (capped - lastCapped) / tickCount,
+            (collected - lastCollected) / seconds, (contended - lastContended) / seconds, t.busiestFlower.load(std::memory_order_relaxed),
+            (frames - lastFrames) / seconds, frames > lastFrames ? double(draws - lastDraws) / (frames - lastFrames) : 0.0,
+            frames > lastFrames ? double(allocs - lastAllocs) / (frames - lastFrames) : 0.0,
+            residentMb(), memory);
+        lastPollen = pollen;
+        lastTicks = ticks;
+        lastFrames = frames;
+        lastDraws = draws;
+        lastAllocs = allocs;
+        lastSteers = steers;
+        lastCapped = capped;
+        lastCollected = collected;
+        lastContended = contended;
+
+        if (length > 0 && length < (int)sizeof(line)) {
+            if (socketMode) {
+                if (sock == INVALID_SOCKET) {
+                    sock = connectUnix(path); // Snapshots are dropped while nobody listens
+                }
+                if (sock != INVALID_SOCKET && send(sock, line, length, 0) == SOCKET_ERROR) {
+                    closesocket(sock);
+                    sock = INVALID_SOCKET;
+                }
+            }
+            else {
+                fwrite(line, 1, length, file);
+                fflush(file);
+            }
+        }
+
+        lock.lock();
+    }
+    lock.unlock();
+
+    if (socketMode) {
+        if (sock != INVALID_SOCKET) closesocket(sock);
+        WSACleanup();
+    }
+    else {
+        fclose(file);
+    }
+}
\ No newline at end of file